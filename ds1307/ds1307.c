@@ -11,48 +11,252 @@
 #include <linux/miscdevice.h>     // misc_register / struct miscdevice
 #include <linux/fs.h>             // file_operations
 #include <linux/atomic.h>         // atomic_t
+#include <linux/debugfs.h>        // per-read bus latency counters
+#include <linux/ktime.h>
+#include <linux/interrupt.h>      // SQW/OUT 1 Hz edge as time source
+#include <linux/moduleparam.h>
+#include <linux/spinlock.h>
+#include <linux/math64.h>
+#include <linux/seqlock.h>        // lock-free readers of the time snapshot
+#include <linux/mm.h>             // vm_insert_page for the shared time page
+#include <linux/wait.h>           // blocking read()/poll() on new time
+#include <linux/poll.h>
+#include <linux/rtc.h>            // rtc_time64_to_tm for extrapolated dates
+#include <linux/kref.h>           // per-device state outlives unbind while files are open
+#include <linux/list.h>
+#include <linux/mutex.h>
+#include <linux/idr.h>            // IDA for misc device names
+#include <linux/sort.h>
 #include "ds1307.h"
+#include "ds1307_ioctl.h"
+
+#define CREATE_TRACE_POINTS
+#include "ds1307_trace.h"
 
 #define DRIVER_NAME "ds1307"
 #define MISC_DEVICE_NAME "rtc_time"
-#define LED_IOC_MAGIC 'k'
-#define GET_TIME_CMD _IOR(LED_IOC_MAGIC, 1, int)
 
-static struct task_struct *ds1307_thread;
-static atomic_t time_to_user = ATOMIC_INIT(0); /* use atomic to avoid race */
+#define DS1307_REG_CONTROL 0x07
+#define DS1307_CH          0x80   /* seconds register: clock halt */
+#define DS1307_SQW_1HZ     0x10   /* SQWE=1, RS1:RS0=00 */
+
+/*
+ * sqw_irq=1: enable the 1 Hz square wave and refresh the cached time from a
+ * threaded IRQ on SQW/OUT instead of polling. Needs an "interrupts" property
+ * on the client node; without one (or if the IRQ can't be had) the polling
+ * kthread is used.
+ *
+ * Without hardware: load i2c-stub with chip_addr=0x68 and describe the
+ * client in an overlay whose interrupt comes from a gpio-sim line, then
+ * toggle that line's "pull" attribute in sysfs to produce falling edges.
+ */
+static bool sqw_irq;
+module_param(sqw_irq, bool, 0444);
+MODULE_PARM_DESC(sqw_irq, "Use the SQW/OUT 1 Hz interrupt instead of polling");
+
+/*
+ * resync_interval=N (seconds, polling mode only): read the chip at probe and
+ * then every N seconds; in between, readers get the last chip time advanced
+ * by ktime_get(). 0 keeps the one-read-per-second behaviour.
+ */
+static unsigned int resync_interval;
+module_param(resync_interval, uint, 0444);
+MODULE_PARM_DESC(resync_interval, "Seconds between chip reads when extrapolating (0 = read every second)");
+
+/*
+ * read()/poll() on /dev/rtc_time wake when the time changes, or with
+ * wake_period=N only when it crosses a multiple of N seconds (30 = TOTP step).
+ */
+static unsigned int wake_period;
+module_param(wake_period, uint, 0644);
+MODULE_PARM_DESC(wake_period, "Wake readers every N seconds of RTC time (0 = every change)");
+
+#define SECS_PER_DAY 86400
+
+/* Read health: consecutive failures drive backoff, bus recovery and state */
+enum ds1307_health {
+    DS1307_HEALTH_OK,
+    DS1307_HEALTH_DEGRADED,      /* failing, still retrying at the normal pace */
+    DS1307_HEALTH_FAILED,        /* DS1307_FAILED_AFTER failures in a row */
+};
+
+static const char * const ds1307_health_names[] = {
+    [DS1307_HEALTH_OK] = "ok",
+    [DS1307_HEALTH_DEGRADED] = "degraded",
+    [DS1307_HEALTH_FAILED] = "failed",
+};
+
+#define DS1307_RECOVER_AFTER 3       /* failures between i2c_recover_bus() attempts */
+#define DS1307_FAILED_AFTER  10
+#define DS1307_BACKOFF_MAX   64      /* seconds between retries, at most */
+
+/*
+ * One per bound DS1307. Freed when the last reference goes: the device holds
+ * one until unbind, every open file holds one, so a reader that outlives
+ * the client sees -ENODEV rather than freed memory.
+ */
+struct ds1307_priv {
+    struct i2c_client *client;
+    struct kref ref;
+    struct list_head node;       /* in ds1307_devices */
+    int id;                      /* from ds1307_ida, picks the misc name */
+    char name[16];
+    struct miscdevice misc;
+    bool gone;                   /* unbound; open files fail from now on */
+
+    struct task_struct *thread;
+    bool sqw_active;
+    struct mutex lock;           /* serialises chip reads/writes that publish */
+    struct rtc_device *rtc;
+
+    enum ds1307_health health;
+    unsigned int fail_count;     /* consecutive failed refreshes */
+    u64 fail_since_ns;           /* ktime_get_ns() of the first failure in the run */
+    u64 recovery_ns_last;        /* first failure to next success */
+    u64 recovery_ns_max;
+    u64 bus_recoveries;
+    unsigned long retry_after;   /* jiffies; no chip reads before this while failing */
+    atomic_t inject_nak;         /* debugfs: fail this many transfers with -EREMOTEIO */
+
+    /* Software alarm, checked on every SQW edge; DS1307 has no alarm registers */
+    time64_t alarm_time;
+    bool alarm_enabled;
+    atomic_t time_to_user;       /* seconds since midnight */
+
+    /* Last chip reading and when it was taken; drift is measured at each resync */
+    struct {
+        spinlock_t lock;
+        bool valid;
+        int base_sec;            /* time2sec() of the last chip read */
+        ktime_t base;            /* ktime_get() right after that read */
+        int drift_last;          /* chip - extrapolated at the last resync, seconds */
+        s64 drift_total;         /* sum of drift_last over all resyncs */
+        u64 span_ns;             /* extrapolated time covered by drift_total */
+        u64 resyncs;
+    } extrap;
+
+    /* Full date/time as published; readers retry instead of locking */
+    seqlock_t snap_lock;
+    struct ds1307_time snap;
+    /* Last chip reading; extrapolated snapshots are derived from it */
+    struct ds1307_time chip_snap;
+    /* Copy of snap that userspace can mmap; mappings hold their own page ref */
+    struct ds1307_time_page *time_page;
+
+    wait_queue_head_t time_wq;
+    atomic_t wake_gen;
+    int last_notified;           /* writer side only */
+
+    /* DS1307_rx() bus latency */
+    struct {
+        u64 reads;
+        u64 errors;
+        u64 total_ns;
+        u64 last_ns;
+        u64 max_ns;
+    } rx_stats;
+
+    /* Event counters; the cheap always-on half of the tracepoints */
+    struct {
+        u64 refreshes;           /* successful chip reads published */
+        u64 tx_errors;
+        u64 wakeups;             /* read()/poll() wake-ups issued */
+        atomic_t ioctls;
+        atomic_t ioctl_errors;
+    } counters;
+    struct dentry *debugfs;      /* /sys/kernel/debug/ds1307/<i2c dev name>/ */
+};
+
+/* Per open file: which wake_gen this reader has already consumed */
+struct ds1307_reader {
+    struct ds1307_priv *priv;
+    int last_gen;
+};
+
+static LIST_HEAD(ds1307_devices);
+static DEFINE_MUTEX(ds1307_devices_lock);
+static DEFINE_IDA(ds1307_ida);
+static struct dentry *ds1307_debugfs_root;
+
+/* Fault injection: consume one injected NAK if debugfs armed any */
+static bool ds1307_inject_nak(struct ds1307_priv *priv)
+{
+    return priv && atomic_dec_if_positive(&priv->inject_nak) >= 0;
+}
 
 int DS1307_tx(struct i2c_client *client, u8 reg, u8 *data, int data_len)
 {
+    struct ds1307_priv *priv = i2c_get_clientdata(client);
     int ret;
     u8 buf[8]; /* 1 reg + up to 7 bytes */
     if (data_len <= 0 || data_len > 7)
         return -EINVAL;
     buf[0] = reg;
     memcpy(&buf[1], data, data_len);
-    ret = i2c_master_send(client, buf, 1 + data_len);
+    if (ds1307_inject_nak(priv))
+        ret = -EREMOTEIO;
+    else
+        ret = i2c_master_send(client, buf, 1 + data_len);
     if (ret != 1 + data_len) {
-        dev_err(&client->dev, "Failed to write reg 0x%02x (len %d): %d\n", reg, data_len, ret);
-        return (ret < 0) ? ret : -EIO;
+        ret = (ret < 0) ? ret : -EIO;
+        if (priv)
+            priv->counters.tx_errors++;
+        trace_ds1307_error(reg, data_len, 1, ret);
+        dev_err_ratelimited(&client->dev, "Failed to write reg 0x%02x (len %d): %d\n", reg, data_len, ret);
+        return ret;
     }
     return 0;
 }
 
+/*
+ * Register read as one repeated-start transfer: write the register pointer,
+ * then read data_len bytes, without a STOP in between and with a single trip
+ * through the adapter lock. Adapters that only speak SMBus (e.g. i2c-stub)
+ * use an I2C block read, which is the same transaction on the wire.
+ */
 int DS1307_rx(struct i2c_client *client, u8 reg, u8 *str, int data_len)
 {
+    struct ds1307_priv *priv = i2c_get_clientdata(client);
+    struct i2c_msg msgs[2] = {
+        { .addr = client->addr, .flags = 0, .len = 1, .buf = &reg },
+        { .addr = client->addr, .flags = I2C_M_RD, .len = data_len, .buf = str },
+    };
+    ktime_t start;
+    u64 ns;
     int ret;
+
     if (data_len <= 0 || data_len > 7)
         return -EINVAL;
-    /* write register pointer */
-    ret = i2c_master_send(client, &reg, 1);
-    if (ret != 1) {
-        dev_err(&client->dev, "Failed to write reg 0x%02x: %d\n", reg, ret);
-        return (ret < 0) ? ret : -EIO;
+
+    start = ktime_get();
+    if (ds1307_inject_nak(priv)) {
+        ret = -EREMOTEIO;
+    } else if (i2c_check_functionality(client->adapter, I2C_FUNC_I2C)) {
+        ret = i2c_transfer(client->adapter, msgs, ARRAY_SIZE(msgs));
+        if (ret == ARRAY_SIZE(msgs))
+            ret = data_len;
+        else if (ret >= 0)
+            ret = -EIO;
+    } else if (i2c_check_functionality(client->adapter, I2C_FUNC_SMBUS_READ_I2C_BLOCK)) {
+        ret = i2c_smbus_read_i2c_block_data(client, reg, data_len, str);
+    } else {
+        ret = -EOPNOTSUPP;
     }
-    /* read block */
-    ret = i2c_master_recv(client, str, data_len);
+    ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+
     if (ret != data_len) {
-        dev_err(&client->dev, "Failed to read %d bytes from reg 0x%02x: %d\n", data_len, reg, ret);
-        return (ret < 0) ? ret : -EIO;
+        ret = (ret < 0) ? ret : -EIO;
+        if (priv)
+            priv->rx_stats.errors++;
+        trace_ds1307_error(reg, data_len, 0, ret);
+        return ret;
+    }
+    if (priv) {
+        priv->rx_stats.reads++;
+        priv->rx_stats.total_ns += ns;
+        priv->rx_stats.last_ns = ns;
+        if (ns > priv->rx_stats.max_ns)
+            priv->rx_stats.max_ns = ns;
     }
     return 0;
 }
@@ -135,112 +339,937 @@ int time2sec(int h, int m, int s){
     return h*3600 + m * 60 + s;
 }
 
-static int ds1307_thread_fn(void *data)
+static int extrap_at(struct ds1307_priv *priv, ktime_t now, u64 *elapsed_ns)
+{
+    u64 ns = ktime_to_ns(ktime_sub(now, priv->extrap.base));
+
+    if (elapsed_ns)
+        *elapsed_ns = ns;
+    return (priv->extrap.base_sec + (int)(div_u64(ns, NSEC_PER_SEC) % SECS_PER_DAY)) % SECS_PER_DAY;
+}
+
+/* Record a fresh chip reading; in extrapolation mode also score the last prediction */
+static void ds1307_publish(struct ds1307_priv *priv, int secs)
+{
+    ktime_t now = ktime_get();
+    unsigned long flags;
+    u64 ns;
+    int d;
+
+    atomic_set(&priv->time_to_user, secs);
+
+    spin_lock_irqsave(&priv->extrap.lock, flags);
+    if (priv->extrap.valid && resync_interval) {
+        d = secs - extrap_at(priv, now, &ns);
+        /* Fold across midnight so 23:59:59 vs 00:00:00 is one second, not a day */
+        if (d > SECS_PER_DAY / 2)
+            d -= SECS_PER_DAY;
+        else if (d < -SECS_PER_DAY / 2)
+            d += SECS_PER_DAY;
+        priv->extrap.drift_last = d;
+        priv->extrap.drift_total += d;
+        priv->extrap.span_ns += ns;
+        priv->extrap.resyncs++;
+    }
+    priv->extrap.base_sec = secs;
+    priv->extrap.base = now;
+    priv->extrap.valid = true;
+    spin_unlock_irqrestore(&priv->extrap.lock, flags);
+}
+
+/* Seconds since midnight as readers should see it */
+static int ds1307_now(struct ds1307_priv *priv)
+{
+    unsigned long flags;
+    int secs;
+
+    if (!resync_interval || priv->sqw_active)
+        return atomic_read(&priv->time_to_user);
+
+    spin_lock_irqsave(&priv->extrap.lock, flags);
+    secs = priv->extrap.valid ? extrap_at(priv, ktime_get(), NULL) : 0;
+    spin_unlock_irqrestore(&priv->extrap.lock, flags);
+    return secs;
+}
+
+static void ds1307_decode(const u8 raw_time[7], u64 mono_ns, struct ds1307_time *t)
+{
+    memset(t, 0, sizeof(*t));
+    t->mono_ns = mono_ns;
+    t->sec = DS1307_reverter(raw_time[0] & 0x7F);
+    t->min = DS1307_reverter(raw_time[1]);
+    t->hour = DS1307_reverter(raw_time[2] & 0x3F);
+    t->wday = raw_time[3] & 0x07;
+    t->mday = DS1307_reverter(raw_time[4] & 0x3F);
+    t->mon = DS1307_reverter(raw_time[5] & 0x1F);
+    t->year = 2000 + DS1307_reverter(raw_time[6]);
+}
+
+static time64_t ds1307_time_to_time64(const struct ds1307_time *t)
+{
+    return mktime64(t->year, t->mon, t->mday, t->hour, t->min, t->sec);
+}
+
+/* Fill the date/time fields of t from secs; leaves mono_ns, generation and wday alone */
+static void ds1307_time_from_time64(time64_t secs, struct ds1307_time *t)
+{
+    struct rtc_time tm;
+
+    rtc_time64_to_tm(secs, &tm);
+    t->year = tm.tm_year + 1900;
+    t->mon = tm.tm_mon + 1;
+    t->mday = tm.tm_mday;
+    t->hour = tm.tm_hour;
+    t->min = tm.tm_min;
+    t->sec = tm.tm_sec;
+}
+
+static void ds1307_publish_snapshot(struct ds1307_priv *priv, const struct ds1307_time *t)
+{
+    struct ds1307_time_page *page = priv->time_page;
+    u32 gen;
+
+    write_seqlock(&priv->snap_lock);
+    gen = priv->snap.generation;
+    priv->snap = *t;
+    priv->snap.generation = gen + 1;
+    /* Already serialised by snap_lock; this is the userspace-visible seq */
+    WRITE_ONCE(page->seq, page->seq + 1);
+    smp_wmb();
+    page->time = priv->snap;
+    smp_wmb();
+    WRITE_ONCE(page->seq, page->seq + 1);
+    write_sequnlock(&priv->snap_lock);
+}
+
+/* Wake blocked readers if secs starts a new second (or a new wake_period) */
+static void ds1307_notify(struct ds1307_priv *priv, int secs)
+{
+    unsigned int period = READ_ONCE(wake_period);
+    int prev = priv->last_notified;
+
+    if (secs == prev)
+        return;
+    priv->last_notified = secs;
+    if (period && prev >= 0 && secs / period == prev / period)
+        return;
+    atomic_inc(&priv->wake_gen);
+    priv->counters.wakeups++;
+    wake_up_interruptible(&priv->time_wq);
+}
+
+/*
+ * Extrapolation mode: advance the last chip reading by the monotonic time
+ * since it was taken and publish that, so the snapshot, the mmap page and
+ * read() keep ticking between resyncs without touching the bus.
+ */
+static void ds1307_extrap_tick(struct ds1307_priv *priv)
+{
+    struct ds1307_time t;
+    u64 now;
+    time64_t base, secs;
+
+    mutex_lock(&priv->lock);
+    t = priv->chip_snap;
+    now = ktime_get_ns();
+    if (!t.mono_ns) {
+        mutex_unlock(&priv->lock);
+        return; /* no successful chip read yet */
+    }
+    base = ds1307_time_to_time64(&t);
+    secs = base + div_u64(now - t.mono_ns, NSEC_PER_SEC);
+    ds1307_time_from_time64(secs, &t);
+    t.mono_ns = now;
+    if (t.wday)
+        t.wday = (t.wday - 1 + (int)(div_s64(secs, SECS_PER_DAY) - div_s64(base, SECS_PER_DAY))) % 7 + 1;
+    ds1307_publish_snapshot(priv, &t);
+    ds1307_notify(priv, time2sec(t.hour, t.min, t.sec));
+    mutex_unlock(&priv->lock);
+}
+
+static void ds1307_read_snapshot(struct ds1307_priv *priv, struct ds1307_time *t)
+{
+    unsigned int seq;
+
+    do {
+        seq = read_seqbegin(&priv->snap_lock);
+        *t = priv->snap;
+    } while (read_seqretry(&priv->snap_lock, seq));
+}
+
+/*
+ * 9 clocks + STOP through the adapter's recovery hook. The root adapter stays
+ * locked for the duration so no other client on the bus (the SSD1306) is
+ * mid-transfer while SCL/SDA are being toggled; i2c_recover_bus() itself
+ * expects the caller to hold the bus.
+ */
+static int ds1307_recover_bus(struct i2c_adapter *adap)
+{
+    int ret;
+
+    if (!adap->bus_recovery_info || !adap->bus_recovery_info->recover_bus)
+        return -EOPNOTSUPP;
+    i2c_lock_bus(adap, I2C_LOCK_ROOT_ADAPTER);
+    ret = adap->bus_recovery_info->recover_bus(adap);
+    i2c_unlock_bus(adap, I2C_LOCK_ROOT_ADAPTER);
+    return ret;
+}
+
+/*
+ * Track a refresh result (called under priv->lock). Every DS1307_RECOVER_AFTER
+ * consecutive failures the adapter gets a bus recovery, which frees SDA if the
+ * chip was left mid-byte and is holding the bus for everyone.
+ */
+static void ds1307_health_update(struct ds1307_priv *priv, int err)
+{
+    struct device *dev = &priv->client->dev;
+    enum ds1307_health old = priv->health, new;
+    int ret;
+
+    if (!err) {
+        if (priv->fail_count) {
+            u64 ns = ktime_get_ns() - priv->fail_since_ns;
+
+            priv->recovery_ns_last = ns;
+            if (ns > priv->recovery_ns_max)
+                priv->recovery_ns_max = ns;
+            dev_info(dev, "reads recovered after %u failures (%llu ms)\n",
+                     priv->fail_count, div_u64(ns, NSEC_PER_MSEC));
+        }
+        priv->fail_count = 0;
+        new = DS1307_HEALTH_OK;
+    } else {
+        if (priv->fail_count++ == 0)
+            priv->fail_since_ns = ktime_get_ns();
+        if (priv->fail_count % DS1307_RECOVER_AFTER == 0) {
+            ret = ds1307_recover_bus(priv->client->adapter);
+            priv->bus_recoveries++;
+            dev_warn_ratelimited(dev, "%u failed reads, bus recovery: %d\n", priv->fail_count, ret);
+        }
+        new = priv->fail_count >= DS1307_FAILED_AFTER ? DS1307_HEALTH_FAILED : DS1307_HEALTH_DEGRADED;
+    }
+
+    if (new != old) {
+        WRITE_ONCE(priv->health, new);
+        dev_notice(dev, "health %s -> %s\n", ds1307_health_names[old], ds1307_health_names[new]);
+        sysfs_notify(&dev->kobj, NULL, "health");
+    }
+}
+
+/* Seconds to wait before retrying after fail_count failures: 1, 2, 4 ... DS1307_BACKOFF_MAX */
+static unsigned int ds1307_backoff(struct ds1307_priv *priv)
+{
+    unsigned int n = priv->fail_count ? priv->fail_count - 1 : 0;
+
+    return n >= 6 ? DS1307_BACKOFF_MAX : 1U << n;
+}
+
+/* Sleep that kthread_stop() can cut short */
+static void ds1307_sleep(long timeout)
+{
+    set_current_state(TASK_INTERRUPTIBLE);
+    if (!kthread_should_stop())
+        schedule_timeout(timeout);
+    __set_current_state(TASK_RUNNING);
+}
+
+/* Read the chip once and publish the result; shared by kthread and IRQ */
+static int ds1307_refresh(struct ds1307_priv *priv)
 {
-    struct i2c_client *client = data;
+    struct i2c_client *client = priv->client;
     u8 raw_time[7];
     int hrs, min, sec;
-    char time_str[9]; /* "HH:MM:SS" + NUL */
+    int ret;
+
+    mutex_lock(&priv->lock);
+    ret = DS1307_get_time(client, raw_time);
+    ds1307_health_update(priv, ret);
+    if (ret) {
+        WRITE_ONCE(priv->retry_after, jiffies + (unsigned long)ds1307_backoff(priv) * HZ);
+        mutex_unlock(&priv->lock);
+        dev_err_ratelimited(&client->dev, "[DS1307] Failed to read time: %d\n", ret);
+        return ret;
+    }
+    ds1307_decode(raw_time, ktime_get_ns(), &priv->chip_snap);
+    ds1307_publish_snapshot(priv, &priv->chip_snap);
+    sec = DS1307_reverter(raw_time[0] & 0x7F);
+    min = DS1307_reverter(raw_time[1]);
+    hrs = DS1307_reverter(raw_time[2]);
+    ds1307_publish(priv, time2sec(hrs, min, sec));
+    ds1307_notify(priv, time2sec(hrs, min, sec));
+    priv->counters.refreshes++;
+    mutex_unlock(&priv->lock);
+    trace_ds1307_read(hrs, min, sec, priv->rx_stats.last_ns);
+    return 0;
+}
+
+static int ds1307_thread_fn(void *data)
+{
+    struct ds1307_priv *priv = data;
 
-    pr_info("ds1307 thread started\n");
+    dev_info(&priv->client->dev, "ds1307 thread started\n");
 
     while (!kthread_should_stop()) {
-        if (DS1307_get_time(client, raw_time) == 0) {
-            sec = DS1307_reverter(raw_time[0] & 0x7F);
-            min = DS1307_reverter(raw_time[1]);
-            hrs = DS1307_reverter(raw_time[2]);
-            atomic_set(&time_to_user, time2sec(hrs, min, sec));
-            snprintf(time_str, sizeof(time_str), "%02d:%02d:%02d", hrs, min, sec);
-            dev_info(&client->dev, "[DS1307] Time: %s\n", time_str);
-        } else {
-            dev_err(&client->dev, "[DS1307] Failed to read time\n");
+        unsigned long deadline;
+
+        if (ds1307_refresh(priv)) {
+            /* Back off instead of hammering a bus the OLED shares */
+            ds1307_sleep((long)ds1307_backoff(priv) * HZ);
+            continue;
+        }
+        if (!resync_interval) {
+            ssleep(1);
+            continue;
+        }
+
+        /*
+         * Until the next resync, wake on each extrapolated second boundary
+         * (measured from the last read) to republish without bus traffic.
+         * Sleeps are interruptible so kthread_stop() gets us out promptly.
+         */
+        deadline = jiffies + (unsigned long)resync_interval * HZ;
+        while (!kthread_should_stop() && time_before(jiffies, deadline)) {
+            u32 phase;
+            long tmo;
+            u64 read_ns;
+
+            /* chip_snap is written under priv->lock; a bare 64-bit load can tear on ARMv7 */
+            mutex_lock(&priv->lock);
+            read_ns = priv->chip_snap.mono_ns;
+            mutex_unlock(&priv->lock);
+            div_u64_rem(ktime_get_ns() - read_ns, NSEC_PER_SEC, &phase);
+            tmo = min_t(long, nsecs_to_jiffies(NSEC_PER_SEC - phase) + 1,
+                        (long)(deadline - jiffies));
+            ds1307_sleep(tmo);
+            ds1307_extrap_tick(priv);
         }
-        ssleep(1);
     }
 
-    pr_info("ds1307 thread stopped\n");
+    dev_info(&priv->client->dev, "ds1307 thread stopped\n");
+    return 0;
+}
+
+/* Runs once per SQW falling edge, i.e. right after the seconds register ticked */
+static irqreturn_t ds1307_sqw_irq_thread(int irq, void *data)
+{
+    struct ds1307_priv *priv = data;
+    struct ds1307_time t;
+
+    /* Failing bus: skip edges until the backoff set by ds1307_refresh() expires */
+    if (READ_ONCE(priv->fail_count) && time_before(jiffies, READ_ONCE(priv->retry_after)))
+        return IRQ_HANDLED;
+    if (ds1307_refresh(priv))
+        return IRQ_HANDLED;
+
+    /* Fire the software alarm once the chip reaches it */
+    if (READ_ONCE(priv->alarm_enabled) && priv->rtc) {
+        ds1307_read_snapshot(priv, &t);
+        if (ds1307_time_to_time64(&t) >= READ_ONCE(priv->alarm_time)) {
+            WRITE_ONCE(priv->alarm_enabled, false);
+            rtc_update_irq(priv->rtc, 1, RTC_AF | RTC_IRQF);
+        }
+    }
+    return IRQ_HANDLED;
+}
+
+static void ds1307_sqw_stop(void *data)
+{
+    struct ds1307_priv *priv = data;
+    u8 ctrl = 0;
+
+    DS1307_tx(priv->client, DS1307_REG_CONTROL, &ctrl, 1);
+}
+
+static int ds1307_sqw_start(struct ds1307_priv *priv)
+{
+    struct i2c_client *client = priv->client;
+    u8 ctrl = DS1307_SQW_1HZ;
+    int ret;
+
+    if (client->irq <= 0)
+        return -ENXIO;
+
+    ret = DS1307_tx(client, DS1307_REG_CONTROL, &ctrl, 1);
+    if (ret)
+        return ret;
+    /* devm runs in reverse: the IRQ is freed before the pin stops toggling */
+    ret = devm_add_action_or_reset(&client->dev, ds1307_sqw_stop, priv);
+    if (ret)
+        return ret;
+
+    ret = devm_request_threaded_irq(&client->dev, client->irq, NULL,
+                                    ds1307_sqw_irq_thread,
+                                    IRQF_ONESHOT | IRQF_TRIGGER_FALLING,
+                                    priv->name, priv);
+    if (ret)
+        return ret;
+
+    /* Publish once now rather than waiting up to a second for the first edge */
+    ds1307_refresh(priv);
+    return 0;
+}
+
+static int ds1307_cmp_time64(const void *a, const void *b)
+{
+    time64_t x = *(const time64_t *)a, y = *(const time64_t *)b;
+
+    return (x > y) - (x < y);
+}
+
+/* GET_MEDIAN_CMD: every bound clock advanced to one instant, median taken */
+static int ds1307_median(struct ds1307_time *out)
+{
+    struct ds1307_priv *priv;
+    struct ds1307_time t;
+    time64_t *vals;
+    u64 now;
+    u32 wday;
+    int n = 0, max = 0;
+
+    mutex_lock(&ds1307_devices_lock);
+    list_for_each_entry(priv, &ds1307_devices, node)
+        max++;
+    vals = kmalloc_array(max ? max : 1, sizeof(*vals), GFP_KERNEL);
+    if (!vals) {
+        mutex_unlock(&ds1307_devices_lock);
+        return -ENOMEM;
+    }
+
+    now = ktime_get_ns();
+    list_for_each_entry(priv, &ds1307_devices, node) {
+        ds1307_read_snapshot(priv, &t);
+        if (!t.mono_ns)
+            continue; /* never read successfully */
+        vals[n++] = ds1307_time_to_time64(&t) + div_u64(now - t.mono_ns, NSEC_PER_SEC);
+    }
+    mutex_unlock(&ds1307_devices_lock);
+
+    if (!n) {
+        kfree(vals);
+        return -ENODATA;
+    }
+    sort(vals, n, sizeof(*vals), ds1307_cmp_time64, NULL);
+
+    memset(out, 0, sizeof(*out));
+    ds1307_time_from_time64(vals[(n - 1) / 2], out);
+    /* 1970-01-01 was a Thursday */
+    div_u64_rem(div_u64(vals[(n - 1) / 2], SECS_PER_DAY) + 4, 7, &wday);
+    out->wday = wday + 1;
+    out->mono_ns = now;
+    out->generation = n;
+    kfree(vals);
     return 0;
 }
 
 static long time_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 {
+    struct ds1307_reader *r = file->private_data;
+    struct ds1307_priv *priv = r->priv;
+    struct ds1307_time t;
     int ret = 0;
     int tmp;
 
+    if (READ_ONCE(priv->gone))
+        return -ENODEV;
+    atomic_inc(&priv->counters.ioctls);
+
     switch (cmd) {
     case GET_TIME_CMD:
-        tmp = atomic_read(&time_to_user);
+        tmp = ds1307_now(priv);
         if (copy_to_user((int __user *)arg, &tmp, sizeof(tmp)))
-            return -EFAULT;
-        pr_info("IOCTL: Returning seconds %d\n", tmp);
+            ret = -EFAULT;
+        break;
+
+    case GET_SNAPSHOT_CMD:
+        ds1307_read_snapshot(priv, &t);
+        if (copy_to_user((void __user *)arg, &t, sizeof(t)))
+            ret = -EFAULT;
+        break;
+
+    case GET_MEDIAN_CMD:
+        ret = ds1307_median(&t);
+        if (!ret && copy_to_user((void __user *)arg, &t, sizeof(t)))
+            ret = -EFAULT;
         break;
 
     default:
-        pr_warn("IOCTL: Unknown command 0x%x\n", cmd);
         ret = -ENOTTY;
     }
+
+    if (ret)
+        atomic_inc(&priv->counters.ioctl_errors);
+    trace_ds1307_ioctl(cmd, ret);
     return ret;
 }
 
+static void ds1307_priv_release(struct kref *ref)
+{
+    struct ds1307_priv *priv = container_of(ref, struct ds1307_priv, ref);
+
+    free_page((unsigned long)priv->time_page);
+    kfree(priv);
+}
+
 /* misc device */
-static int misc_open(struct inode *node, struct file *filep) { return 0; }
-static int misc_release(struct inode *node, struct file *filep) { return 0; }
+static int misc_open(struct inode *node, struct file *filep)
+{
+    /* misc_open() hands us the miscdevice, under misc_mtx */
+    struct ds1307_priv *priv = container_of(filep->private_data, struct ds1307_priv, misc);
+    struct ds1307_reader *r;
+
+    r = kzalloc(sizeof(*r), GFP_KERNEL);
+    if (!r)
+        return -ENOMEM;
+    kref_get(&priv->ref);
+    r->priv = priv;
+    /* A fresh reader blocks until the next change, not the last one */
+    r->last_gen = atomic_read(&priv->wake_gen);
+    filep->private_data = r;
+    return 0;
+}
+
+static int misc_release(struct inode *node, struct file *filep)
+{
+    struct ds1307_reader *r = filep->private_data;
+
+    kref_put(&r->priv->ref, ds1307_priv_release);
+    kfree(r);
+    return 0;
+}
+
+/* Blocks until the time changes (see wake_period), then returns one struct ds1307_time */
+static ssize_t misc_read(struct file *filep, char __user *buf, size_t count, loff_t *ppos)
+{
+    struct ds1307_reader *r = filep->private_data;
+    struct ds1307_priv *priv = r->priv;
+    struct ds1307_time t;
+    int ret;
+
+    if (count < sizeof(t))
+        return -EINVAL;
+
+    if (atomic_read(&priv->wake_gen) == r->last_gen) {
+        if (filep->f_flags & O_NONBLOCK)
+            return -EAGAIN;
+        ret = wait_event_interruptible(priv->time_wq,
+                                       atomic_read(&priv->wake_gen) != r->last_gen ||
+                                       READ_ONCE(priv->gone));
+        if (ret)
+            return ret;
+    }
+    if (READ_ONCE(priv->gone))
+        return -ENODEV;
+    r->last_gen = atomic_read(&priv->wake_gen);
+
+    ds1307_read_snapshot(priv, &t);
+    if (copy_to_user(buf, &t, sizeof(t)))
+        return -EFAULT;
+    return sizeof(t);
+}
+
+static __poll_t misc_poll(struct file *filep, poll_table *wait)
+{
+    struct ds1307_reader *r = filep->private_data;
+    struct ds1307_priv *priv = r->priv;
+
+    poll_wait(filep, &priv->time_wq, wait);
+    if (READ_ONCE(priv->gone))
+        return EPOLLHUP | EPOLLERR;
+    return atomic_read(&priv->wake_gen) != r->last_gen ? EPOLLIN | EPOLLRDNORM : 0;
+}
+
+/*
+ * Read-only, one page, offset 0: the time page and nothing else. The page is
+ * inserted rather than remapped so the mapping holds a reference and stays
+ * valid after unbind frees the device.
+ */
+static int misc_mmap(struct file *filep, struct vm_area_struct *vma)
+{
+    struct ds1307_reader *r = filep->private_data;
+
+    if (vma->vm_pgoff != 0 || vma->vm_end - vma->vm_start != PAGE_SIZE)
+        return -EINVAL;
+    if (vma->vm_flags & VM_WRITE)
+        return -EPERM;
+
+    vma->vm_flags &= ~VM_MAYWRITE;
+    vma->vm_flags |= VM_DONTEXPAND | VM_DONTDUMP;
+    return vm_insert_page(vma, vma->vm_start, virt_to_page(r->priv->time_page));
+}
 
 static const struct file_operations misc_fops = {
     .owner = THIS_MODULE,
     .open = misc_open,
     .release = misc_release,
+    .read = misc_read,
+    .poll = misc_poll,
+    .llseek = no_llseek,
     .unlocked_ioctl = time_ioctl,
+    .mmap = misc_mmap,
+};
+
+static ssize_t drift_last_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+    struct ds1307_priv *priv = dev_get_drvdata(dev);
+
+    return sprintf(buf, "%d\n", READ_ONCE(priv->extrap.drift_last));
+}
+static DEVICE_ATTR_RO(drift_last);
+
+/* Long-run rate error of the kernel clock against the chip, parts per million */
+static ssize_t drift_ppm_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+    struct ds1307_priv *priv = dev_get_drvdata(dev);
+    unsigned long flags;
+    s64 total;
+    u64 span_s;
+
+    spin_lock_irqsave(&priv->extrap.lock, flags);
+    total = priv->extrap.drift_total;
+    span_s = div_u64(priv->extrap.span_ns, NSEC_PER_SEC);
+    spin_unlock_irqrestore(&priv->extrap.lock, flags);
+
+    return sprintf(buf, "%lld\n", span_s ? div64_s64(total * 1000000, span_s) : 0LL);
+}
+static DEVICE_ATTR_RO(drift_ppm);
+
+static ssize_t resyncs_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+    struct ds1307_priv *priv = dev_get_drvdata(dev);
+
+    return sprintf(buf, "%llu\n", READ_ONCE(priv->extrap.resyncs));
+}
+static DEVICE_ATTR_RO(resyncs);
+
+/* ok / degraded / failed; pollable, notified on every change */
+static ssize_t health_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+    struct ds1307_priv *priv = dev_get_drvdata(dev);
+
+    return sprintf(buf, "%s\n", ds1307_health_names[READ_ONCE(priv->health)]);
+}
+static DEVICE_ATTR_RO(health);
+
+static ssize_t consecutive_failures_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+    struct ds1307_priv *priv = dev_get_drvdata(dev);
+
+    return sprintf(buf, "%u\n", READ_ONCE(priv->fail_count));
+}
+static DEVICE_ATTR_RO(consecutive_failures);
+
+/* Last and worst time from first failed read to the next good one */
+static ssize_t recovery_ms_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+    struct ds1307_priv *priv = dev_get_drvdata(dev);
+
+    return sprintf(buf, "%llu %llu\n",
+                   div_u64(READ_ONCE(priv->recovery_ns_last), NSEC_PER_MSEC),
+                   div_u64(READ_ONCE(priv->recovery_ns_max), NSEC_PER_MSEC));
+}
+static DEVICE_ATTR_RO(recovery_ms);
+
+static struct attribute *ds1307_attrs[] = {
+    &dev_attr_drift_last.attr,
+    &dev_attr_drift_ppm.attr,
+    &dev_attr_resyncs.attr,
+    &dev_attr_health.attr,
+    &dev_attr_consecutive_failures.attr,
+    &dev_attr_recovery_ms.attr,
+    NULL,
+};
+ATTRIBUTE_GROUPS(ds1307);
+
+/* RTC class interface; hwclock, systemd and chrony see the chip as /dev/rtcN */
+static int ds1307_rtc_read_time(struct device *dev, struct rtc_time *tm)
+{
+    struct ds1307_priv *priv = dev_get_drvdata(dev);
+    u8 raw_time[7];
+    int ret;
+
+    /* Same lock as ds1307_refresh(): DS1307_rx() updates rx_stats and NAK injection */
+    mutex_lock(&priv->lock);
+    ret = DS1307_get_time(priv->client, raw_time);
+    mutex_unlock(&priv->lock);
+    if (ret)
+        return ret;
+    if (raw_time[0] & DS1307_CH)
+        return -EINVAL; /* oscillator stopped: the time is not valid */
+
+    tm->tm_sec = DS1307_reverter(raw_time[0] & 0x7F);
+    tm->tm_min = DS1307_reverter(raw_time[1]);
+    tm->tm_hour = DS1307_reverter(raw_time[2] & 0x3F);
+    tm->tm_mday = DS1307_reverter(raw_time[4] & 0x3F);
+    tm->tm_mon = DS1307_reverter(raw_time[5] & 0x1F) - 1;
+    tm->tm_year = DS1307_reverter(raw_time[6]) + 100;
+    tm->tm_wday = 0;
+    if (rtc_valid_tm(tm))
+        return -EINVAL; /* never-set registers (day/month 0, bad BCD) */
+
+    /* The day register is only as good as whoever last set it: derive wday from the date */
+    rtc_time64_to_tm(rtc_tm_to_time64(tm), tm);
+    return 0;
+}
+
+static int ds1307_rtc_set_time(struct device *dev, struct rtc_time *tm)
+{
+    struct ds1307_priv *priv = dev_get_drvdata(dev);
+    unsigned long flags;
+    u8 buf[7];
+    int ret;
+
+    if (tm->tm_year < 100 || tm->tm_year > 199)
+        return -EINVAL; /* two-digit year register: 2000..2099 */
+
+    buf[0] = DS1307_converter(tm->tm_sec) & 0x7F; /* CH=0 starts the oscillator */
+    buf[1] = DS1307_converter(tm->tm_min);
+    buf[2] = DS1307_converter(tm->tm_hour);       /* 24-hour mode */
+    buf[3] = tm->tm_wday + 1;
+    buf[4] = DS1307_converter(tm->tm_mday);
+    buf[5] = DS1307_converter(tm->tm_mon + 1);
+    buf[6] = DS1307_converter(tm->tm_year - 100);
+
+    mutex_lock(&priv->lock);
+    ret = DS1307_tx(priv->client, 0x00, buf, sizeof(buf));
+    mutex_unlock(&priv->lock);
+    if (ret)
+        return ret;
+
+    /* A deliberate step is not drift: restart the extrapolation baseline */
+    spin_lock_irqsave(&priv->extrap.lock, flags);
+    priv->extrap.valid = false;
+    spin_unlock_irqrestore(&priv->extrap.lock, flags);
+
+    /* Republish now so misc readers and extrapolation don't serve the old time */
+    ds1307_refresh(priv);
+    return 0;
+}
+
+static int ds1307_rtc_read_alarm(struct device *dev, struct rtc_wkalrm *alrm)
+{
+    struct ds1307_priv *priv = dev_get_drvdata(dev);
+
+    rtc_time64_to_tm(READ_ONCE(priv->alarm_time), &alrm->time);
+    alrm->enabled = READ_ONCE(priv->alarm_enabled);
+    return 0;
+}
+
+static int ds1307_rtc_set_alarm(struct device *dev, struct rtc_wkalrm *alrm)
+{
+    struct ds1307_priv *priv = dev_get_drvdata(dev);
+
+    WRITE_ONCE(priv->alarm_time, rtc_tm_to_time64(&alrm->time));
+    WRITE_ONCE(priv->alarm_enabled, !!alrm->enabled);
+    return 0;
+}
+
+static int ds1307_rtc_alarm_irq_enable(struct device *dev, unsigned int enabled)
+{
+    struct ds1307_priv *priv = dev_get_drvdata(dev);
+
+    WRITE_ONCE(priv->alarm_enabled, !!enabled);
+    return 0;
+}
+
+/* Alarms (and so RTC_UIE through the core) need the SQW tick to be checked on */
+static const struct rtc_class_ops ds1307_rtc_ops_alarm = {
+    .read_time = ds1307_rtc_read_time,
+    .set_time = ds1307_rtc_set_time,
+    .read_alarm = ds1307_rtc_read_alarm,
+    .set_alarm = ds1307_rtc_set_alarm,
+    .alarm_irq_enable = ds1307_rtc_alarm_irq_enable,
 };
 
-static struct miscdevice misc_device = {
-    .minor = MISC_DYNAMIC_MINOR,
-    .name = MISC_DEVICE_NAME,
-    .fops = &misc_fops,
+static const struct rtc_class_ops ds1307_rtc_ops = {
+    .read_time = ds1307_rtc_read_time,
+    .set_time = ds1307_rtc_set_time,
 };
 
+static void ds1307_debugfs_remove(void *data)
+{
+    struct ds1307_priv *priv = data;
+
+    debugfs_remove_recursive(priv->debugfs);
+}
+
+static int ds1307_debugfs_init(struct ds1307_priv *priv)
+{
+    struct dentry *d;
+
+    d = debugfs_create_dir(dev_name(&priv->client->dev), ds1307_debugfs_root);
+    priv->debugfs = d;
+    debugfs_create_u64("read_count", 0444, d, &priv->rx_stats.reads);
+    debugfs_create_u64("read_errors", 0444, d, &priv->rx_stats.errors);
+    debugfs_create_u64("read_total_ns", 0444, d, &priv->rx_stats.total_ns);
+    debugfs_create_u64("read_last_ns", 0444, d, &priv->rx_stats.last_ns);
+    debugfs_create_u64("read_max_ns", 0444, d, &priv->rx_stats.max_ns);
+    debugfs_create_u64("refreshes", 0444, d, &priv->counters.refreshes);
+    debugfs_create_u64("write_errors", 0444, d, &priv->counters.tx_errors);
+    debugfs_create_u64("wakeups", 0444, d, &priv->counters.wakeups);
+    debugfs_create_atomic_t("ioctls", 0444, d, &priv->counters.ioctls);
+    debugfs_create_atomic_t("ioctl_errors", 0444, d, &priv->counters.ioctl_errors);
+    debugfs_create_u64("bus_recoveries", 0444, d, &priv->bus_recoveries);
+    /* echo N > inject_nak: the next N transfers fail as if the chip NAKed */
+    debugfs_create_atomic_t("inject_nak", 0644, d, &priv->inject_nak);
+    return devm_add_action_or_reset(&priv->client->dev, ds1307_debugfs_remove, priv);
+}
+
+/* Registered first, so it runs last: fail open files and drop the device's ref */
+static void ds1307_priv_put(void *data)
+{
+    struct ds1307_priv *priv = data;
+
+    WRITE_ONCE(priv->gone, true);
+    wake_up_interruptible_all(&priv->time_wq);
+    kref_put(&priv->ref, ds1307_priv_release);
+}
+
+static void ds1307_thread_stop(void *data)
+{
+    struct ds1307_priv *priv = data;
+
+    kthread_stop(priv->thread);
+}
+
+static void ds1307_unlist(void *data)
+{
+    struct ds1307_priv *priv = data;
+
+    mutex_lock(&ds1307_devices_lock);
+    list_del(&priv->node);
+    mutex_unlock(&ds1307_devices_lock);
+}
+
+static void ds1307_misc_deregister(void *data)
+{
+    struct ds1307_priv *priv = data;
+
+    misc_deregister(&priv->misc);
+}
+
+static void ds1307_ida_free(void *data)
+{
+    struct ds1307_priv *priv = data;
+
+    ida_free(&ds1307_ida, priv->id);
+}
+
 static int ds1307_probe(struct i2c_client *client, const struct i2c_device_id *id)
 {
+    struct device *dev = &client->dev;
+    struct ds1307_priv *priv;
+    u8 ch;
     int ret;
 
-    pr_info("ds1307: probe success, addr=0x%02x\n", client->addr);
-    
-    ret = DS1307_update_time(client,0,0,0); 
+    priv = kzalloc(sizeof(*priv), GFP_KERNEL);
+    if (!priv)
+        return -ENOMEM;
+    priv->time_page = (struct ds1307_time_page *)get_zeroed_page(GFP_KERNEL);
+    if (!priv->time_page) {
+        kfree(priv);
+        return -ENOMEM;
+    }
+    kref_init(&priv->ref);
+    priv->client = client;
+    priv->last_notified = -1;
+    mutex_init(&priv->lock);
+    spin_lock_init(&priv->extrap.lock);
+    seqlock_init(&priv->snap_lock);
+    init_waitqueue_head(&priv->time_wq);
+    INIT_LIST_HEAD(&priv->node);
+    i2c_set_clientdata(client, priv);
+    ret = devm_add_action_or_reset(dev, ds1307_priv_put, priv);
+    if (ret)
+        return ret;
+
+    priv->id = ida_alloc(&ds1307_ida, GFP_KERNEL);
+    if (priv->id < 0)
+        return priv->id;
+    ret = devm_add_action_or_reset(dev, ds1307_ida_free, priv);
+    if (ret)
+        return ret;
+    /* The first clock keeps the historical name so existing users still work */
+    if (priv->id == 0)
+        strscpy(priv->name, MISC_DEVICE_NAME, sizeof(priv->name));
+    else
+        snprintf(priv->name, sizeof(priv->name), MISC_DEVICE_NAME "%d", priv->id);
 
-    ds1307_thread = kthread_run(ds1307_thread_fn, client, "ds1307_thread");
-    if (IS_ERR(ds1307_thread)) {
-        dev_err(&client->dev, "Failed to create ds1307 thread\n");
-        ds1307_thread = NULL;
-        return PTR_ERR(ds1307_thread);
+    dev_info(dev, "probe, addr=0x%02x\n", client->addr);
+
+    /*
+     * Only a halted oscillator (first power-up, dead backup cell) gets the
+     * time reset; a running clock keeps its time across driver reloads.
+     */
+    ret = DS1307_rx(client, 0x00, &ch, 1);
+    if (ret == 0 && (ch & DS1307_CH)) {
+        dev_warn(dev, "oscillator was halted, starting it at 00:00:00\n");
+        DS1307_update_time(client, 0, 0, 0);
     }
 
-    ret = misc_register(&misc_device);
-    if (ret) {
-        dev_err(&client->dev, "%s: Failed to register misc device: %d\n", DRIVER_NAME, ret);
-        /* cleanup thread before returning */
-        if (ds1307_thread) {
-            kthread_stop(ds1307_thread);
-            ds1307_thread = NULL;
+    ret = ds1307_debugfs_init(priv);
+    if (ret)
+        return ret;
+
+    ret = devm_device_add_groups(dev, ds1307_groups);
+    if (ret)
+        dev_warn(dev, "Failed to create sysfs attributes: %d\n", ret);
+
+    if (sqw_irq) {
+        ret = ds1307_sqw_start(priv);
+        if (ret == 0)
+            priv->sqw_active = true;
+        else
+            dev_warn(dev, "SQW irq unavailable (%d), polling instead\n", ret);
+    }
+
+    if (!priv->sqw_active) {
+        priv->thread = kthread_run(ds1307_thread_fn, priv, "ds1307/%d", priv->id);
+        if (IS_ERR(priv->thread)) {
+            dev_err(dev, "Failed to create ds1307 thread\n");
+            return PTR_ERR(priv->thread);
         }
+        ret = devm_add_action_or_reset(dev, ds1307_thread_stop, priv);
+        if (ret)
+            return ret;
+    }
+
+    mutex_lock(&ds1307_devices_lock);
+    list_add_tail(&priv->node, &ds1307_devices);
+    mutex_unlock(&ds1307_devices_lock);
+    ret = devm_add_action_or_reset(dev, ds1307_unlist, priv);
+    if (ret)
+        return ret;
+
+    priv->misc.minor = MISC_DYNAMIC_MINOR;
+    priv->misc.name = priv->name;
+    priv->misc.fops = &misc_fops;
+    priv->misc.parent = dev;
+    ret = misc_register(&priv->misc);
+    if (ret) {
+        dev_err(dev, "%s: Failed to register misc device: %d\n", DRIVER_NAME, ret);
         return ret;
     }
-    dev_info(&client->dev, "%s: Misc device registered at /dev/%s\n", DRIVER_NAME, MISC_DEVICE_NAME);
+    ret = devm_add_action_or_reset(dev, ds1307_misc_deregister, priv);
+    if (ret)
+        return ret;
+    dev_info(dev, "%s: Misc device registered at /dev/%s\n", DRIVER_NAME, priv->name);
+
+    priv->rtc = devm_rtc_device_register(dev, DRIVER_NAME,
+                                         priv->sqw_active ? &ds1307_rtc_ops_alarm : &ds1307_rtc_ops,
+                                         THIS_MODULE);
+    if (IS_ERR(priv->rtc)) {
+        /* The misc interface still works without the RTC class device */
+        dev_warn(dev, "Failed to register RTC device: %ld\n", PTR_ERR(priv->rtc));
+        priv->rtc = NULL;
+    }
 
     return 0;
 }
 
+/* Everything probe set up is devm-managed and torn down after this returns */
 static int ds1307_remove(struct i2c_client *client)
 {
-    pr_info("ds1307: remove\n");
-
-    if (ds1307_thread) {
-        pr_info("stopping ds1307 thread\n");
-        kthread_stop(ds1307_thread);
-        ds1307_thread = NULL;
-    }
-
-    misc_deregister(&misc_device);
-    dev_info(&client->dev, "%s: Misc device deregistered.\n", DRIVER_NAME);
+    dev_info(&client->dev, "remove\n");
     return 0;
 }
 
@@ -267,7 +1296,26 @@ static struct i2c_driver ds1307_driver = {
     .id_table = ds1307_id,
 };
 
-module_i2c_driver(ds1307_driver);
+static int __init ds1307_init(void)
+{
+    int ret;
+
+    ds1307_debugfs_root = debugfs_create_dir(DRIVER_NAME, NULL);
+    ret = i2c_add_driver(&ds1307_driver);
+    if (ret)
+        debugfs_remove_recursive(ds1307_debugfs_root);
+    return ret;
+}
+
+static void __exit ds1307_exit(void)
+{
+    i2c_del_driver(&ds1307_driver);
+    debugfs_remove_recursive(ds1307_debugfs_root);
+    ida_destroy(&ds1307_ida);
+}
+
+module_init(ds1307_init);
+module_exit(ds1307_exit);
 
 MODULE_LICENSE("GPL");
 MODULE_AUTHOR("Dang Van Phuc");
@@ -0,0 +1,70 @@
+#ifndef DS1307_IOCTL_H
+#define DS1307_IOCTL_H
+
+/*
+ * /dev/rtc_time (first chip) and /dev/rtc_timeN interface, shared by
+ * ds1307.c and the userspace programs.
+ */
+
+#include <linux/types.h>
+#include <linux/ioctl.h>
+
+#define DS1307_IOC_MAGIC 'k'
+
+/* Seconds since midnight, as an int */
+#define GET_TIME_CMD _IOR(DS1307_IOC_MAGIC, 1, int)
+
+/*
+ * Full chip time plus the CLOCK_MONOTONIC instant it was read at, so a
+ * reader can tell how old it is (or extrapolate from it) without another
+ * syscall. generation increases by one every time the driver publishes.
+ */
+struct ds1307_time {
+    __u64 mono_ns;
+    __u32 generation;
+    __u16 year;     /* 2000..2099 */
+    __u8  mon;      /* 1..12 */
+    __u8  mday;     /* 1..31 */
+    __u8  wday;     /* 1..7, as kept by the chip */
+    __u8  hour;     /* 0..23 */
+    __u8  min;
+    __u8  sec;
+    __u32 reserved;
+};
+
+#define GET_SNAPSHOT_CMD _IOR(DS1307_IOC_MAGIC, 2, struct ds1307_time)
+
+/*
+ * Median over every DS1307 the driver has bound, each advanced to the same
+ * instant (mono_ns). generation holds the number of clocks that took part;
+ * wday is derived from the date (1 = Sunday).
+ */
+#define GET_MEDIAN_CMD _IOR(DS1307_IOC_MAGIC, 3, struct ds1307_time)
+
+/*
+ * mmap(NULL, 4096, PROT_READ, MAP_SHARED, fd, 0) on /dev/rtc_time* maps this
+ * page read-only. seq is odd while the driver is rewriting time; readers
+ * copy time and retry if seq was odd or changed meanwhile.
+ */
+struct ds1307_time_page {
+    __u32 seq;
+    __u32 reserved;
+    struct ds1307_time time;
+};
+
+#ifndef __KERNEL__
+static inline void ds1307_time_page_read(const struct ds1307_time_page *pg,
+                                         struct ds1307_time *t)
+{
+    __u32 s1, s2;
+
+    do {
+        s1 = __atomic_load_n(&pg->seq, __ATOMIC_ACQUIRE);
+        *t = *(const volatile struct ds1307_time *)&pg->time;
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        s2 = __atomic_load_n(&pg->seq, __ATOMIC_RELAXED);
+    } while ((s1 & 1) || s1 != s2);
+}
+#endif
+
+#endif
@@ -0,0 +1,76 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * Tracepoints for the ds1307 driver, in place of per-tick printk:
+ *   echo 1 > /sys/kernel/tracing/events/ds1307/enable
+ */
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM ds1307
+
+#if !defined(_DS1307_TRACE_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _DS1307_TRACE_H
+
+#include <linux/tracepoint.h>
+
+/* One successful time read from the chip */
+TRACE_EVENT(ds1307_read,
+    TP_PROTO(int hour, int min, int sec, u64 bus_ns),
+    TP_ARGS(hour, min, sec, bus_ns),
+    TP_STRUCT__entry(
+        __field(int, hour)
+        __field(int, min)
+        __field(int, sec)
+        __field(u64, bus_ns)
+    ),
+    TP_fast_assign(
+        __entry->hour = hour;
+        __entry->min = min;
+        __entry->sec = sec;
+        __entry->bus_ns = bus_ns;
+    ),
+    TP_printk("time=%02d:%02d:%02d bus_ns=%llu",
+              __entry->hour, __entry->min, __entry->sec,
+              (unsigned long long)__entry->bus_ns)
+);
+
+TRACE_EVENT(ds1307_ioctl,
+    TP_PROTO(unsigned int cmd, int ret),
+    TP_ARGS(cmd, ret),
+    TP_STRUCT__entry(
+        __field(unsigned int, cmd)
+        __field(int, ret)
+    ),
+    TP_fast_assign(
+        __entry->cmd = cmd;
+        __entry->ret = ret;
+    ),
+    TP_printk("cmd=0x%x ret=%d", __entry->cmd, __entry->ret)
+);
+
+/* Failed register transfer; write is 1 for DS1307_tx, 0 for DS1307_rx */
+TRACE_EVENT(ds1307_error,
+    TP_PROTO(u8 reg, int len, int write, int err),
+    TP_ARGS(reg, len, write, err),
+    TP_STRUCT__entry(
+        __field(u8, reg)
+        __field(int, len)
+        __field(int, write)
+        __field(int, err)
+    ),
+    TP_fast_assign(
+        __entry->reg = reg;
+        __entry->len = len;
+        __entry->write = write;
+        __entry->err = err;
+    ),
+    TP_printk("%s reg=0x%02x len=%d err=%d",
+              __entry->write ? "write" : "read",
+              __entry->reg, __entry->len, __entry->err)
+);
+
+#endif /* _DS1307_TRACE_H */
+
+#undef TRACE_INCLUDE_PATH
+#define TRACE_INCLUDE_PATH .
+#undef TRACE_INCLUDE_FILE
+#define TRACE_INCLUDE_FILE ds1307_trace
+#include <trace/define_trace.h>
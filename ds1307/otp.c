@@ -1,11 +1,27 @@
 #include "otp.h"
 #include "sha1.h"
+#include "sha2.h"
 #include <string.h>
 
+#define OTP_MULTI_CHUNK 64 // keys hashed per SHA1Transform_xN() call in hotp_multi()
+
+/* HMAC backend for one hash: otp_key_init_alg() stores a pointer to it in the
+ * key context, so hotp_ctx() makes one indirect call and never tests the algorithm. */
+struct otp_hmac_ops {
+    size_t digest_len;
+    void (*init)(otp_key_ctx* kctx, const uint8_t* key, size_t klen);
+    void (*mac)(const otp_key_ctx* kctx, uint64_t interval, uint8_t* digest);
+};
+
+// 10^0 .. 10^9; 10-digit codes need no reduction since dt() is below 2^31
+static const uint32_t pow10_table[OTP_MAX_DIGITS] = {
+    1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000
+};
+
 static uint32_t truncateToDigits(uint32_t a, int digits) {
-		uint32_t p[] = {0,10,100,1000,10000,10000,100000,1000000,10000000,10000000}; 
-    uint32_t res = a % p[digits];
-    return res;
+    if (digits >= OTP_MAX_DIGITS)
+        return a;
+    return a % pow10_table[digits > 0 ? digits : 0];
 }
 
 //uint8_t* hmacsha(unsigned char* key, int klen, uint64_t interval) {
@@ -13,57 +29,190 @@ static uint32_t truncateToDigits(uint32_t a, int digits) {
 //	
 //}
 
-unsigned char* hmacsha(const unsigned char* key, int klen, uint64_t interval) {
-    // B? d?m tinh cho digest (20 byte, kích thu?c d?u ra c?a SHA-1)
-    static unsigned char digest[20];
-    // M?ng cho khóa dã d?m và XOR v?i ipad/opad
+/* XOR the (already reduced) key into ipad/opad blocks of the hash's block size */
+static void hmac_pads(const uint8_t* key, size_t klen, size_t block, uint8_t* k_ipad, uint8_t* k_opad) {
+    memset(k_ipad, 0, block);
+    memset(k_opad, 0, block);
+    memcpy(k_ipad, key, klen);
+    memcpy(k_opad, key, klen);
+    for (size_t i = 0; i < block; i++) {
+        k_ipad[i] ^= 0x36;
+        k_opad[i] ^= 0x5C;
+    }
+}
+
+static void hmac_sha1_init(otp_key_ctx* kctx, const uint8_t* key, size_t klen) {
     unsigned char k_ipad[64], k_opad[64];
-    // B? d?m t?m n?u c?n bam khóa
     unsigned char tk[20];
+    SHA1_CTX ctx;
 
-    // Bu?c 1: X? lý khóa
     if (klen > 64) {
-        SHA1_CTX ctx;
         SHA1Init(&ctx);
         SHA1Update(&ctx, key, klen);
         SHA1Final(tk, &ctx);
-        key = tk;    // S? d?ng khóa dã bam
-        klen = 20;   // Ð? dài m?i là 20 byte
+        key = tk;
+        klen = 20;
     }
+    hmac_pads(key, klen, 64, k_ipad, k_opad);
+
+    // Each pad is exactly one block, so the midstate is a single compression
+    SHA1Init(&ctx);
+    SHA1Transform(ctx.state, k_ipad);
+    memcpy(kctx->h.sha1.istate, ctx.state, sizeof(kctx->h.sha1.istate));
+    SHA1Init(&ctx);
+    SHA1Transform(ctx.state, k_opad);
+    memcpy(kctx->h.sha1.ostate, ctx.state, sizeof(kctx->h.sha1.ostate));
 
-    // Ð?m khóa d?n 64 byte và t?o k_ipad, k_opad
     memset(k_ipad, 0, 64);
     memset(k_opad, 0, 64);
-    memcpy(k_ipad, key, klen);
-    memcpy(k_opad, key, klen);
+    memset(tk, 0, 20);
+    memset(&ctx, 0, sizeof(ctx));
+}
 
-    // XOR v?i ipad (0x36) và opad (0x5C)
-    for (int i = 0; i < 64; i++) {
-        k_ipad[i] ^= 0x36;
-        k_opad[i] ^= 0x5C;
-    }
+/* Resume a SHA-1 context from a midstate that has absorbed one 64-byte block */
+static void sha1_resume(SHA1_CTX* ctx, const uint32_t midstate[5]) {
+    memcpy(ctx->state, midstate, sizeof(ctx->state));
+    ctx->count[0] = 64 << 3;
+    ctx->count[1] = 0;
+}
 
-    // Bu?c 2: Tính bam trong
+/* HMAC-SHA1(key, interval) from the midstates: one compression per hash */
+static void hmac_sha1_mac(const otp_key_ctx* kctx, uint64_t interval, uint8_t* digest) {
     SHA1_CTX ctx;
     unsigned char inner_hash[20];
-    SHA1Init(&ctx);
-    SHA1Update(&ctx, k_ipad, 64);                  // 64 byte t? k_ipad
-    SHA1Update(&ctx, (const unsigned char*)&interval, 8); // 8 byte t? interval
-    SHA1Final(inner_hash, &ctx);                   // K?t qu?: 20 byte
 
-    // Bu?c 3: Tính bam ngoài
-    SHA1Init(&ctx);
-    SHA1Update(&ctx, k_opad, 64);                  // 64 byte t? k_opad
-    SHA1Update(&ctx, inner_hash, 20);              // 20 byte t? inner_hash
-    SHA1Final(digest, &ctx);                       // K?t qu? cu?i cùng vào digest
+    sha1_resume(&ctx, kctx->h.sha1.istate);
+    SHA1Update(&ctx, (const unsigned char*)&interval, 8);
+    SHA1Final(inner_hash, &ctx);
+
+    sha1_resume(&ctx, kctx->h.sha1.ostate);
+    SHA1Update(&ctx, inner_hash, 20);
+    SHA1Final(digest, &ctx);
+}
 
-    // Bu?c 4: Tr? v? con tr? d?n digest
+static void hmac_sha256_init(otp_key_ctx* kctx, const uint8_t* key, size_t klen) {
+    unsigned char k_ipad[64], k_opad[64];
+    unsigned char tk[32];
+    SHA256_CTX ctx;
+
+    if (klen > 64) {
+        SHA256Init(&ctx);
+        SHA256Update(&ctx, key, klen);
+        SHA256Final(tk, &ctx);
+        key = tk;
+        klen = 32;
+    }
+    hmac_pads(key, klen, 64, k_ipad, k_opad);
+
+    SHA256Init(&ctx);
+    SHA256Transform(ctx.state, k_ipad);
+    memcpy(kctx->h.sha256.istate, ctx.state, sizeof(kctx->h.sha256.istate));
+    SHA256Init(&ctx);
+    SHA256Transform(ctx.state, k_opad);
+    memcpy(kctx->h.sha256.ostate, ctx.state, sizeof(kctx->h.sha256.ostate));
+
+    memset(k_ipad, 0, 64);
+    memset(k_opad, 0, 64);
+    memset(tk, 0, 32);
+    memset(&ctx, 0, sizeof(ctx));
+}
+
+static void hmac_sha256_mac(const otp_key_ctx* kctx, uint64_t interval, uint8_t* digest) {
+    SHA256_CTX ctx;
+    unsigned char inner_hash[32];
+
+    memcpy(ctx.state, kctx->h.sha256.istate, sizeof(ctx.state));
+    ctx.count = 64;
+    SHA256Update(&ctx, (const unsigned char*)&interval, 8);
+    SHA256Final(inner_hash, &ctx);
+
+    memcpy(ctx.state, kctx->h.sha256.ostate, sizeof(ctx.state));
+    ctx.count = 64;
+    SHA256Update(&ctx, inner_hash, 32);
+    SHA256Final(digest, &ctx);
+}
+
+static void hmac_sha512_init(otp_key_ctx* kctx, const uint8_t* key, size_t klen) {
+    unsigned char k_ipad[128], k_opad[128];
+    unsigned char tk[64];
+    SHA512_CTX ctx;
+
+    if (klen > 128) {
+        SHA512Init(&ctx);
+        SHA512Update(&ctx, key, klen);
+        SHA512Final(tk, &ctx);
+        key = tk;
+        klen = 64;
+    }
+    hmac_pads(key, klen, 128, k_ipad, k_opad);
+
+    SHA512Init(&ctx);
+    SHA512Transform(ctx.state, k_ipad);
+    memcpy(kctx->h.sha512.istate, ctx.state, sizeof(kctx->h.sha512.istate));
+    SHA512Init(&ctx);
+    SHA512Transform(ctx.state, k_opad);
+    memcpy(kctx->h.sha512.ostate, ctx.state, sizeof(kctx->h.sha512.ostate));
+
+    memset(k_ipad, 0, 128);
+    memset(k_opad, 0, 128);
+    memset(tk, 0, 64);
+    memset(&ctx, 0, sizeof(ctx));
+}
+
+static void hmac_sha512_mac(const otp_key_ctx* kctx, uint64_t interval, uint8_t* digest) {
+    SHA512_CTX ctx;
+    unsigned char inner_hash[64];
+
+    memcpy(ctx.state, kctx->h.sha512.istate, sizeof(ctx.state));
+    ctx.count = 128;
+    SHA512Update(&ctx, (const unsigned char*)&interval, 8);
+    SHA512Final(inner_hash, &ctx);
+
+    memcpy(ctx.state, kctx->h.sha512.ostate, sizeof(ctx.state));
+    ctx.count = 128;
+    SHA512Update(&ctx, inner_hash, 64);
+    SHA512Final(digest, &ctx);
+}
+
+// Indexed by otp_alg
+static const struct otp_hmac_ops otp_hmac_ops_table[] = {
+    [OTP_SHA1]   = { 20, hmac_sha1_init,   hmac_sha1_mac },
+    [OTP_SHA256] = { 32, hmac_sha256_init, hmac_sha256_mac },
+    [OTP_SHA512] = { 64, hmac_sha512_init, hmac_sha512_mac },
+};
+
+void otp_key_init_alg(otp_key_ctx* kctx, otp_alg alg, const uint8_t* key, size_t klen) {
+    kctx->ops = &otp_hmac_ops_table[alg];
+    kctx->ops->init(kctx, key, klen);
+}
+
+void otp_key_init(otp_key_ctx* kctx, const uint8_t* key, size_t klen) {
+    otp_key_init_alg(kctx, OTP_SHA1, key, klen);
+}
+
+void otp_key_wipe(otp_key_ctx* kctx) {
+    volatile uint8_t* p = (volatile uint8_t*)kctx;
+    for (size_t i = 0; i < sizeof(*kctx); i++)
+        p[i] = 0;
+}
+
+unsigned char* hmacsha_r(const unsigned char* key, int klen, uint64_t interval, unsigned char digest[20]) {
+    otp_key_ctx kctx;
+
+    otp_key_init(&kctx, key, klen);
+    hmac_sha1_mac(&kctx, interval, digest);
+    otp_key_wipe(&kctx);
     return digest;
 }
 
-static uint32_t dt(uint8_t* digest) {
-    // straight from RFC4226 Section 5.4
-    uint64_t offset = digest[19] & 0x0F;
+unsigned char* hmacsha(const unsigned char* key, int klen, uint64_t interval) {
+    static unsigned char digest[20];
+    return hmacsha_r(key, klen, interval, digest);
+}
+
+static uint32_t dt(uint8_t* digest, size_t len) {
+    // straight from RFC4226 Section 5.4 (RFC 6238 uses the last byte for SHA-256/512 too)
+    uint64_t offset = digest[len - 1] & 0x0F;
     uint32_t bin_code = (digest[offset] & 0x7f) << 24 |
                         (digest[offset+1] & 0xff) << 16 |
                         (digest[offset+2] & 0xff) <<  8 |
@@ -72,21 +221,104 @@ static uint32_t dt(uint8_t* digest) {
     return bin_code;
 }
 
-uint32_t hotp(uint8_t* key, size_t klen, uint64_t interval, int digits) {
-    // make interval big endian
+static uint64_t to_be64(uint64_t interval) {
     uint32_t endianness = 0xdeadbeef; // little trick to coax out memory issues
     if ((*(const uint8_t *)&endianness) == 0xef) {
         interval = ((interval & 0x00000000ffffffff) << 32) | ((interval & 0xffffffff00000000) >> 32);
         interval = ((interval & 0x0000ffff0000ffff) << 16) | ((interval & 0xffff0000ffff0000) >> 16);
         interval = ((interval & 0x00ff00ff00ff00ff) <<  8) | ((interval & 0xff00ff00ff00ff00) >>  8);
     };
+    return interval;
+}
+
+uint32_t hotp(uint8_t* key, size_t klen, uint64_t interval, int digits) {
+    // make interval big endian
+    interval = to_be64(interval);
 
-    uint8_t* digest = (uint8_t*)hmacsha(key, klen, interval);
-    uint32_t dt_bincode = dt(digest);
+    uint8_t digest[20];
+    hmacsha_r(key, klen, interval, digest);
+    uint32_t dt_bincode = dt(digest, sizeof(digest));
     uint32_t res = truncateToDigits(dt_bincode, digits);
     return res;
 }
 
+uint32_t hotp_ctx(const otp_key_ctx* kctx, uint64_t interval, int digits) {
+    uint8_t digest[64];
+
+    kctx->ops->mac(kctx, to_be64(interval), digest);
+    return truncateToDigits(dt(digest, kctx->ops->digest_len), digits);
+}
+
+/* Store a SHA-1 state as the 20-byte big-endian digest */
+static void sha1_state_digest(const uint32_t state[5], uint8_t digest[20]) {
+    for (int i = 0; i < 20; i++)
+        digest[i] = (uint8_t)(state[i >> 2] >> ((3 - (i & 3)) * 8));
+}
+
+size_t hotp_multi(const otp_key_ctx* kctxs, size_t n, uint64_t interval, int digits, uint32_t* out) {
+    // Every key hashes the same counter, so all lanes share one padded inner block:
+    // 8-byte counter, 0x80, zeros, length (64 + 8) * 8 bits.
+    uint8_t inner[64] = {0};
+    uint8_t outer[OTP_MULTI_CHUNK][64];
+    uint32_t state[OTP_MULTI_CHUNK][5];
+    const unsigned char* blocks[OTP_MULTI_CHUNK];
+    size_t idx[OTP_MULTI_CHUNK];
+    uint8_t digest[20];
+    uint64_t be_interval = to_be64(interval);
+
+    memcpy(inner, &be_interval, 8);
+    inner[8] = 0x80;
+    inner[62] = (72 * 8) >> 8;
+    inner[63] = (72 * 8) & 0xff;
+
+    for (size_t base = 0; base < n; base += OTP_MULTI_CHUNK) {
+        size_t end = n - base < OTP_MULTI_CHUNK ? n : base + OTP_MULTI_CHUNK;
+        size_t lanes = 0;
+
+        // Only SHA-1 keys go to the SIMD lanes; SHA-256/512 keys take hotp_ctx()
+        for (size_t i = base; i < end; i++) {
+            if (kctxs[i].ops != &otp_hmac_ops_table[OTP_SHA1]) {
+                out[i] = hotp_ctx(&kctxs[i], interval, digits);
+                continue;
+            }
+            memcpy(state[lanes], kctxs[i].h.sha1.istate, sizeof(state[lanes]));
+            blocks[lanes] = inner;
+            idx[lanes++] = i;
+        }
+        SHA1Transform_xN(state, blocks, lanes);
+
+        // Outer block: inner hash, 0x80, zeros, length (64 + 20) * 8 bits
+        for (size_t j = 0; j < lanes; j++) {
+            memset(outer[j], 0, 64);
+            sha1_state_digest(state[j], outer[j]);
+            outer[j][20] = 0x80;
+            outer[j][62] = (84 * 8) >> 8;
+            outer[j][63] = (84 * 8) & 0xff;
+            memcpy(state[j], kctxs[idx[j]].h.sha1.ostate, sizeof(state[j]));
+            blocks[j] = outer[j];
+        }
+        SHA1Transform_xN(state, blocks, lanes);
+
+        for (size_t j = 0; j < lanes; j++) {
+            sha1_state_digest(state[j], digest);
+            out[idx[j]] = truncateToDigits(dt(digest, sizeof(digest)), digits);
+        }
+    }
+    memset(outer, 0, sizeof(outer));
+    memset(digest, 0, sizeof(digest));
+    return n;
+}
+
+size_t hotp_batch(uint8_t* key, size_t klen, uint64_t first, size_t count, int digits, uint32_t* out) {
+    otp_key_ctx kctx;
+
+    otp_key_init(&kctx, key, klen);
+    for (size_t i = 0; i < count; i++)
+        out[i] = hotp_ctx(&kctx, first + i, digits);
+    otp_key_wipe(&kctx);
+    return count;
+}
+
 double my_floor(double x) {
     if (x >= 0) {
         return (double)((int)x);
@@ -100,11 +332,90 @@ double my_floor(double x) {
 }
 
 
+uint64_t totp_step(int64_t unix_time, int64_t t0, uint32_t period) {
+    uint64_t delta;
+
+    if (unix_time <= t0 || period == 0)
+        return 0;
+    delta = (uint64_t)unix_time - (uint64_t)t0;
+    // Until 2106 the delta fits 32 bits: a 32-bit divide is much cheaper than
+    // the 64-bit libgcc helper on cores without a hardware divider.
+    if (delta <= UINT32_MAX)
+        return (uint32_t)delta / period;
+    return delta / period;
+}
+
 time_t getTime(time_t T0) {
-    return my_floor((time(NULL) - T0)/step);
+    return (time_t)totp_step(time(NULL), T0, step);
 }
 
 uint32_t totp(uint8_t* key, size_t klen, uint64_t time, int digits) {
     uint32_t totp = hotp(key, klen, time, digits);
     return totp;
-}
\ No newline at end of file
+}
+
+size_t totp_window(uint8_t* key, size_t klen, uint64_t time, unsigned int window, int digits, uint32_t* out) {
+    uint64_t first = time > window ? time - window : 0;
+    return hotp_batch(key, klen, first, time + window - first + 1, digits, out);
+}
+
+void totp_verifier_init(totp_verifier* v, const uint8_t* key, size_t klen, int digits, unsigned int window) {
+    otp_key_init(&v->key, key, klen);
+    v->digits = digits;
+    v->window = window;
+    v->predict = 1;
+    v->t0 = 0;
+    v->period = step;
+    v->drift = 0;
+    v->last_step = 0;
+    v->has_last = 0;
+}
+
+/* 1 if a == b, without a data-dependent branch */
+static int ct_equal_u32(uint32_t a, uint32_t b) {
+    uint32_t d = a ^ b;
+    return (int)(1 ^ ((d | (0u - d)) >> 31));
+}
+
+static int totp_try(totp_verifier* v, uint64_t candidate, uint32_t code) {
+    if (v->has_last && candidate <= v->last_step)
+        return 0; // replay of an already accepted (or older) code
+    return ct_equal_u32(hotp_ctx(&v->key, candidate, v->digits), code);
+}
+
+int totp_verify(totp_verifier* v, uint64_t time, uint32_t code) {
+    int64_t w = v->window;
+    int64_t first = 0; // offset tried first, skipped in the scan below
+
+    // Most clients drift slowly: the offset that matched last time usually matches again
+    if (v->predict && v->drift >= -w && v->drift <= w) {
+        first = v->drift;
+        if ((int64_t)time + first >= 0 && totp_try(v, time + first, code))
+            goto accept;
+    } else if (totp_try(v, time, code)) {
+        goto accept;
+    }
+
+    // Nearest steps first: 0, -1, +1, -2, +2, ...
+    for (int64_t d = 0; d <= w; d++) {
+        for (int64_t off = -d; off <= d; off += (d ? 2 * d : 1)) {
+            if (off == first || (int64_t)time + off < 0)
+                continue;
+            if (totp_try(v, time + off, code)) {
+                first = off;
+                goto accept;
+            }
+        }
+    }
+    return 0;
+
+accept:
+    v->drift = first;
+    v->last_step = time + first;
+    v->has_last = 1;
+    return 1;
+}
+
+int totp_verify_time(totp_verifier* v, int64_t unix_time, uint32_t code) {
+    return totp_verify(v, totp_step(unix_time, v->t0, v->period), code);
+}
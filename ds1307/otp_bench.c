@@ -0,0 +1,333 @@
+// Benchmark cho thu vien OTP/SHA-1 (chay tren host hoac tren BBB)
+// Build: gcc -O2 -o otp_bench otp_bench.c otp.c sha1.c sha2.c -lpthread
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <pthread.h>
+#include <unistd.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAVE_RDTSC
+#endif
+#include "otp.h"
+#include "sha1.h"
+
+static uint8_t secret_key[] = "12345678901234567890";
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// So sanh hotp() tung ma mot voi hotp_batch() cho ca cua so
+static void bench_window(unsigned int window, long iters) {
+    uint32_t codes[2 * 100 + 1];
+    volatile uint32_t sink = 0;
+    uint64_t now = 56666666;
+    double t0, t_single, t_batch;
+    long n = 0;
+
+    t0 = now_sec();
+    for (long it = 0; it < iters; it++) {
+        for (uint64_t c = now - window; c <= now + window; c++)
+            sink ^= hotp(secret_key, sizeof(secret_key) - 1, c, 6);
+    }
+    t_single = now_sec() - t0;
+
+    t0 = now_sec();
+    for (long it = 0; it < iters; it++) {
+        n = totp_window(secret_key, sizeof(secret_key) - 1, now, window, 6, codes);
+        sink ^= codes[n - 1];
+    }
+    t_batch = now_sec() - t0;
+
+    n = (2 * window + 1) * iters;
+    printf("window +-%-3u  hotp(): %10.0f codes/s   hotp_batch(): %10.0f codes/s   x%.2f\n",
+           window, n / t_single, n / t_batch, t_single / t_batch);
+    (void)sink;
+}
+
+// Chi phi moi ma: hotp() (dung lai khoa moi lan) so voi hotp_ctx() (midstate co san)
+static void bench_key_ctx(long iters) {
+    otp_key_ctx kctx;
+    volatile uint32_t sink = 0;
+    double t0, t_hotp, t_ctx;
+
+    t0 = now_sec();
+    for (long i = 0; i < iters; i++)
+        sink ^= hotp(secret_key, sizeof(secret_key) - 1, i, 6);
+    t_hotp = now_sec() - t0;
+
+    otp_key_init(&kctx, secret_key, sizeof(secret_key) - 1);
+    t0 = now_sec();
+    for (long i = 0; i < iters; i++)
+        sink ^= hotp_ctx(&kctx, i, 6);
+    t_ctx = now_sec() - t0;
+    otp_key_wipe(&kctx);
+
+    printf("hotp():     %8.1f ns/code\nhotp_ctx(): %8.1f ns/code   x%.2f\n",
+           t_hotp * 1e9 / iters, t_ctx * 1e9 / iters, t_hotp / t_ctx);
+
+    // Cung mot hotp_ctx(), thuat toan chon luc otp_key_init_alg()
+    static const char *alg_names[] = {"SHA1", "SHA256", "SHA512"};
+    for (int alg = OTP_SHA1; alg <= OTP_SHA512; alg++) {
+        otp_key_init_alg(&kctx, (otp_alg)alg, secret_key, sizeof(secret_key) - 1);
+        t0 = now_sec();
+        for (long i = 0; i < iters; i++)
+            sink ^= hotp_ctx(&kctx, i, 8);
+        t_ctx = now_sec() - t0;
+        otp_key_wipe(&kctx);
+        printf("hotp_ctx() HMAC-%-6s %8.1f ns/code\n", alg_names[alg], t_ctx * 1e9 / iters);
+    }
+    (void)sink;
+}
+
+// Sinh ma cho ca doi token: hotp_ctx() tung khoa so voi hotp_multi() (SIMD lanes)
+static void bench_fleet(size_t nkeys, long rounds) {
+    otp_key_ctx *kctxs = malloc(nkeys * sizeof(*kctxs));
+    uint32_t *codes = malloc(nkeys * sizeof(*codes));
+    volatile uint32_t sink = 0;
+    double t0, t_single, t_multi;
+    uint8_t key[20];
+
+    for (size_t i = 0; i < nkeys; i++) {
+        for (size_t j = 0; j < sizeof(key); j++)
+            key[j] = (uint8_t)(i * 131 + j);
+        otp_key_init(&kctxs[i], key, sizeof(key));
+    }
+
+    t0 = now_sec();
+    for (long r = 0; r < rounds; r++)
+        for (size_t i = 0; i < nkeys; i++)
+            sink ^= hotp_ctx(&kctxs[i], r, 6);
+    t_single = now_sec() - t0;
+
+    t0 = now_sec();
+    for (long r = 0; r < rounds; r++) {
+        hotp_multi(kctxs, nkeys, r, 6, codes);
+        sink ^= codes[nkeys - 1];
+    }
+    t_multi = now_sec() - t0;
+
+    printf("%zu keys, %u lanes  hotp_ctx(): %10.0f codes/s   hotp_multi(): %10.0f codes/s   x%.2f\n",
+           nkeys, SHA1Lanes(), nkeys * rounds / t_single, nkeys * rounds / t_multi, t_single / t_multi);
+    free(kctxs);
+    free(codes);
+    (void)sink;
+}
+
+// SHA1Transform() cho tung backend (handsoff = memcpy cu, scalar = zero-copy): cycles/byte (rdtsc) tren x86, ns/byte tren ARM
+static void bench_transform(long blocks) {
+    static const char *backends[] = {"handsoff", "scalar", "shani", "armce"};
+    static unsigned char buf[64 * 256];
+    uint32_t state[5] = {0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0};
+    const char *prev = SHA1Backend();
+
+    memset(buf, 0x5a, sizeof(buf));
+    for (size_t b = 0; b < sizeof(backends) / sizeof(backends[0]); b++) {
+        double t0, ns;
+
+        if (SHA1SetBackend(backends[b]) != 0) {
+            printf("%-8s khong ho tro tren CPU nay\n", backends[b]);
+            continue;
+        }
+#ifdef HAVE_RDTSC
+        uint64_t c0 = __rdtsc();
+#endif
+        t0 = now_sec();
+        for (long i = 0; i < blocks; i++)
+            SHA1Transform(state, buf + 64 * (i & 255));
+        ns = (now_sec() - t0) * 1e9;
+#ifdef HAVE_RDTSC
+        printf("%-8s %6.2f cycles/byte  %8.1f MB/s\n", backends[b],
+               (double)(__rdtsc() - c0) / (blocks * 64.0), blocks * 64.0 / ns * 1e3);
+#else
+        printf("%-8s %6.2f ns/byte     %8.1f MB/s\n", backends[b],
+               ns / (blocks * 64.0), blocks * 64.0 / ns * 1e3);
+#endif
+    }
+    SHA1SetBackend(prev);
+}
+
+// Thong luong SHA1Update() cho input lon (1 KB .. max_mb MB) va SHA1File() (mmap)
+static void bench_stream(size_t max_mb) {
+    size_t max = max_mb << 20;
+    unsigned char *buf = malloc(max);
+    unsigned char digest[20];
+    char path[] = "/tmp/otp_bench_XXXXXX";
+    SHA1_CTX ctx;
+    int fd;
+
+    if (!buf) {
+        printf("khong du bo nho cho %zu MB\n", max_mb);
+        return;
+    }
+    memset(buf, 0xa5, max);
+    for (size_t size = 1024; size <= max; size *= size < (1 << 20) ? 32 : 4) {
+        // Lap lai de moi kich thuoc hash it nhat ~256 MB
+        long reps = (256L << 20) / size + 1;
+        double t0 = now_sec(), t;
+
+        for (long r = 0; r < reps; r++) {
+            SHA1Init(&ctx);
+            for (size_t off = 0; off < size; off += 1u << 30)
+                SHA1Update(&ctx, buf + off, size - off < (1u << 30) ? size - off : 1u << 30);
+            SHA1Final(digest, &ctx);
+        }
+        t = now_sec() - t0;
+        printf("SHA1Update %8zu KB: %8.1f MB/s\n", size >> 10, reps * (double)size / t / (1 << 20));
+    }
+
+    fd = mkstemp(path);
+    if (fd >= 0) {
+        size_t size = max < (64u << 20) ? max : 64u << 20;
+        double t0, t;
+
+        if (write(fd, buf, size) == (ssize_t)size) {
+            t0 = now_sec();
+            SHA1File(digest, path);
+            t = now_sec() - t0;
+            printf("SHA1File   %8zu KB: %8.1f MB/s (page cache)\n", size >> 10, size / t / (1 << 20));
+        }
+        close(fd);
+        unlink(path);
+    }
+    free(buf);
+}
+
+// totp_verify(): client lech +3 buoc, cua so +-5, co va khong co du doan drift.
+// Moi lan dang nhap cach nhau 10 buoc (5 phut) de replay check khong cat bot cua so.
+static void bench_verify_drift(long iters) {
+    totp_verifier v;
+    otp_key_ctx client;
+    uint32_t *codes = malloc(iters * sizeof(*codes));
+    uint64_t base = 56666666;
+    long ok;
+
+    otp_key_init(&client, secret_key, sizeof(secret_key) - 1);
+    for (long i = 0; i < iters; i++)
+        codes[i] = hotp_ctx(&client, base + 10 * i + 3, 6);
+
+    for (int predict = 0; predict <= 1; predict++) {
+        double t0, t;
+
+        totp_verifier_init(&v, secret_key, sizeof(secret_key) - 1, 6, 5);
+        v.predict = predict;
+        ok = 0;
+        t0 = now_sec();
+        for (long i = 0; i < iters; i++)
+            ok += totp_verify(&v, base + 10 * i, codes[i]);
+        t = now_sec() - t0;
+        printf("%-22s %10.0f verify/s  (%ld/%ld accepted)\n",
+               predict ? "du doan drift:" : "quet ca cua so:", iters / t, ok, iters);
+    }
+    otp_key_wipe(&client);
+    otp_key_wipe(&v.key);
+    free(codes);
+}
+
+// Toc do totp_step() so voi duong cu cua getTime(): my_floor() tren double, ep kieu int.
+// Kiem tra dung/sai tu 1970 qua 2106 nam o otp_check.c
+static void bench_time_step(long iters) {
+    volatile uint64_t sink = 0;
+    double t0, t_int, t_fp;
+
+    t0 = now_sec();
+    for (long i = 0; i < iters; i++)
+        sink += totp_step(1700000000 + i, 0, step);
+    t_int = now_sec() - t0;
+    t0 = now_sec();
+    for (long i = 0; i < iters; i++) {
+        volatile int64_t t = 1700000000 + i; // khong cho compiler gap phep chia
+        sink += (uint64_t)my_floor((double)t / step);
+    }
+    t_fp = now_sec() - t0;
+    printf("totp_step(): %6.2f ns   my_floor(): %6.2f ns\n", t_int * 1e9 / iters, t_fp * 1e9 / iters);
+    (void)sink;
+}
+
+struct verify_job {
+    long checks;
+    uint32_t accepted;
+};
+
+// Moi thread kiem tra OTP voi cua so +-1 bang hotp() (khong con buffer static)
+static void *verify_worker(void *arg) {
+    struct verify_job *job = arg;
+    uint64_t now = 56666666;
+    uint32_t code = hotp(secret_key, sizeof(secret_key) - 1, now, 6);
+
+    for (long i = 0; i < job->checks; i++) {
+        for (uint64_t c = now - 1; c <= now + 1; c++) {
+            if (hotp(secret_key, sizeof(secret_key) - 1, c, 6) == code) {
+                job->accepted++;
+                break;
+            }
+        }
+    }
+    return NULL;
+}
+
+static void bench_threads(long checks) {
+    long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+    pthread_t tid[256];
+    struct verify_job jobs[256];
+    double base = 0;
+
+    if (ncpu < 1)
+        ncpu = 1;
+    if (ncpu > 256)
+        ncpu = 256;
+    // 1, 2, 4, ... va luon do them so core thuc te
+    for (long n = 1; n <= ncpu; n = (n < ncpu && n * 2 > ncpu) ? ncpu : n * 2) {
+        double t0 = now_sec(), dt_s, rate;
+
+        for (long i = 0; i < n; i++) {
+            jobs[i].checks = checks;
+            jobs[i].accepted = 0;
+            pthread_create(&tid[i], NULL, verify_worker, &jobs[i]);
+        }
+        for (long i = 0; i < n; i++)
+            pthread_join(tid[i], NULL);
+        dt_s = now_sec() - t0;
+        rate = n * checks / dt_s;
+        if (n == 1)
+            base = rate;
+        printf("%3ld thread(s): %10.0f checks/s   scaling x%.2f\n", n, rate, rate / base);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    long iters = argc > 1 ? atol(argv[1]) : 20000;
+    size_t max_mb = argc > 2 ? (size_t)atol(argv[2]) : 64; // input lon nhat cho SHA1Update (BBB chi co 512 MB RAM)
+    unsigned int windows[] = {1, 3, 10, 100};
+
+    printf("== HOTP look-ahead window (%ld lan moi cua so) ==\n", iters);
+    for (size_t i = 0; i < sizeof(windows) / sizeof(windows[0]); i++)
+        bench_window(windows[i], iters / windows[i] + 1);
+
+    printf("\n== otp_key_ctx ==\n");
+    bench_key_ctx(iters * 10);
+
+    printf("\n== Time step (integer) ==\n");
+    bench_time_step(iters * 500);
+
+    printf("\n== totp_verify (drift +3, window +-5) ==\n");
+    bench_verify_drift(iters * 5);
+
+    printf("\n== SHA1Transform backends (mac dinh: %s) ==\n", SHA1Backend());
+    bench_transform(iters * 50);
+
+    printf("\n== SHA1Update streaming ==\n");
+    bench_stream(max_mb);
+
+    printf("\n== Fleet (multi-buffer SHA-1) ==\n");
+    bench_fleet(4096, iters / 1000 + 1);
+
+    printf("\n== Verify song song (pthreads) ==\n");
+    bench_threads(iters);
+    return 0;
+}
@@ -0,0 +1,46 @@
+// Kiem tra totp_step() tu 1970 qua 2106 (moc 2^32 giay) den 2200; exit 1 neu co sai
+// Build: gcc -O2 -o otp_check otp_check.c otp.c sha1.c sha2.c
+#include <stdio.h>
+#include <stdint.h>
+#include "otp.h"
+
+// Unix time cua 00:00:00 ngay 1/1 nam y (thuat toan days-from-civil)
+static int64_t year_start(int64_t y) {
+    int64_t yy = y - 1, era = yy / 400, yoe = yy - era * 400;
+    int64_t doe = yoe * 365 + yoe / 4 - yoe / 100 + 306; // 1/3/(y-1) + 306 ngay = 1/1/y
+    return (era * 146097 + doe - 719468) * 86400;
+}
+
+static long checks, bad;
+
+// So voi phep chia 64-bit lam moc
+static void check(int64_t now, int64_t t0, uint32_t period) {
+    uint64_t want = now > t0 ? (uint64_t)(now - t0) / period : 0;
+    uint64_t got = totp_step(now, t0, period);
+
+    checks++;
+    if (got != want) {
+        if (bad++ < 10)
+            printf("SAI: totp_step(%lld, %lld, %u) = %llu, dung la %llu\n",
+                   (long long)now, (long long)t0, period,
+                   (unsigned long long)got, (unsigned long long)want);
+    }
+}
+
+int main(void) {
+    static const uint32_t periods[] = {1, 30, 60, 90};
+    static const int64_t t0s[] = {0, 1000000000};
+
+    for (int64_t y = 1970; y <= 2200; y++)
+        for (int64_t dt_s = -1; dt_s <= 1; dt_s++)
+            for (size_t p = 0; p < sizeof(periods) / sizeof(periods[0]); p++)
+                for (size_t k = 0; k < sizeof(t0s) / sizeof(t0s[0]); k++)
+                    check(year_start(y) + dt_s, t0s[k], periods[p]);
+    // Quanh 2^32 giay (07/02/2106)
+    for (int64_t dt_s = -2; dt_s <= 2; dt_s++)
+        for (size_t p = 0; p < sizeof(periods) / sizeof(periods[0]); p++)
+            check(((int64_t)1 << 32) + dt_s, 0, periods[p]);
+
+    printf("totp_step() 1970..2200: %ld/%ld dung\n", checks - bad, checks);
+    return bad ? 1 : 0;
+}
@@ -19,12 +19,29 @@ A million repetitions of "a"
 
 #include <stdio.h>
 #include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 /* for uint32_t */
 #include <stdint.h>
+#include <stdatomic.h>
 
 #include "sha1.h"
 
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SHA1_X86
+#include <immintrin.h>
+#endif
+
+#if defined(__aarch64__) && (defined(__ARM_FEATURE_SHA2) || defined(__ARM_FEATURE_CRYPTO))
+#define SHA1_ARMCE
+#include <arm_neon.h>
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#endif
+
 
 #define rol(value, bits) (((value) << (bits)) | ((value) >> (32 - (bits))))
 
@@ -57,9 +74,11 @@ const union {
 #define R4(v,w,x,y,z,i) z+=(w^x^y)+blk(i)+0xCA62C1D6+rol(v,5);w=rol(w,30);
 
 
-/* Hash a single 512-bit block. This is the core of the algorithm. */
+/* Hash a single 512-bit block. This is the core of the algorithm.
+ * Original version: copies the block (SHA1HANDSOFF) and byte-swaps the copy;
+ * kept as the "handsoff" backend for comparison. */
 
-void SHA1Transform(
+static void SHA1Transform_handsoff(
     uint32_t state[5],
     const unsigned char buffer[64]
 )
@@ -185,6 +204,423 @@ void SHA1Transform(
 }
 
 
+/* Zero-copy version: blk0() loads each big-endian word straight from
+ * buffer[] into a rolling 16-word schedule, so there is no memcpy and no
+ * write to the input. GCC turns load_be32() into a single bswap/rev load. */
+
+#define load_be32(p) (((uint32_t) (p)[0] << 24) | ((uint32_t) (p)[1] << 16) | \
+    ((uint32_t) (p)[2] << 8) | (uint32_t) (p)[3])
+
+#undef blk0
+#undef blk
+#define blk0(i) (W[i] = load_be32(buffer + 4 * (i)))
+#define blk(i) (W[(i)&15] = rol(W[((i)+13)&15]^W[((i)+8)&15] \
+    ^W[((i)+2)&15]^W[(i)&15],1))
+
+/* Five rounds rotate the working variables back into place */
+#define R5(R,i) R(a, b, c, d, e, i); R(e, a, b, c, d, i + 1); \
+    R(d, e, a, b, c, i + 2); R(c, d, e, a, b, i + 3); R(b, c, d, e, a, i + 4);
+
+static void SHA1Transform_scalar(
+    uint32_t state[5],
+    const unsigned char buffer[64]
+)
+{
+    uint32_t a, b, c, d, e;
+    uint32_t W[16];
+
+    a = state[0];
+    b = state[1];
+    c = state[2];
+    d = state[3];
+    e = state[4];
+    R5(R0, 0); R5(R0, 5); R5(R0, 10);
+    R0(a, b, c, d, e, 15); R1(e, a, b, c, d, 16); R1(d, e, a, b, c, 17);
+    R1(c, d, e, a, b, 18); R1(b, c, d, e, a, 19);
+    R5(R2, 20); R5(R2, 25); R5(R2, 30); R5(R2, 35);
+    R5(R3, 40); R5(R3, 45); R5(R3, 50); R5(R3, 55);
+    R5(R4, 60); R5(R4, 65); R5(R4, 70); R5(R4, 75);
+    state[0] += a;
+    state[1] += b;
+    state[2] += c;
+    state[3] += d;
+    state[4] += e;
+    /* Wipe variables */
+    a = b = c = d = e = 0;
+    memset(W, '\0', sizeof(W));
+}
+
+#undef R5
+
+/* Multi-block wrappers for the one-block-at-a-time backends */
+
+static void SHA1Blocks_handsoff(
+    uint32_t state[5],
+    const unsigned char *data,
+    size_t nblocks
+)
+{
+    for (; nblocks; nblocks--, data += 64)
+        SHA1Transform_handsoff(state, data);
+}
+
+static void SHA1Blocks_scalar(
+    uint32_t state[5],
+    const unsigned char *data,
+    size_t nblocks
+)
+{
+    for (; nblocks; nblocks--, data += 64)
+        SHA1Transform_scalar(state, data);
+}
+
+#ifdef SHA1_X86
+/* Intel SHA extensions: four rounds per sha1rnds4, schedule in sha1msg1/2.
+ * Rounds 16..79 follow one pattern; the few extra schedule ops it issues
+ * in the last groups only touch words that are no longer read. */
+
+#define SHANI_LOAD(m, off) \
+    m = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) (buffer + (off))), MASK)
+
+#define SHANI_R4(Ea, Eb, m, mn, mnn, mp, f) \
+    Ea = _mm_sha1nexte_epu32(Ea, m); Eb = ABCD; \
+    mn = _mm_sha1msg2_epu32(mn, m); \
+    ABCD = _mm_sha1rnds4_epu32(ABCD, Ea, f); \
+    mp = _mm_sha1msg1_epu32(mp, m); \
+    mnn = _mm_xor_si128(mnn, m);
+
+__attribute__((target("sha,sse4.1")))
+static void SHA1Blocks_shani(
+    uint32_t state[5],
+    const unsigned char *buffer,
+    size_t nblocks
+)
+{
+    const __m128i MASK = _mm_set_epi64x(0x0001020304050607ULL, 0x08090a0b0c0d0e0fULL);
+    __m128i ABCD, ABCD_SAVE, E0, E0_SAVE, E1;
+    __m128i M0, M1, M2, M3;
+
+    /* The state stays in registers across all blocks */
+    ABCD = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *) state), 0x1B);
+    E0 = _mm_set_epi32((int) state[4], 0, 0, 0);
+
+    for (; nblocks; nblocks--, buffer += 64)
+    {
+        ABCD_SAVE = ABCD;
+        E0_SAVE = E0;
+
+        /* Rounds 0-15: message words come straight from the input */
+        SHANI_LOAD(M0, 0);
+        E0 = _mm_add_epi32(E0, M0);
+        E1 = ABCD;
+        ABCD = _mm_sha1rnds4_epu32(ABCD, E0, 0);
+
+        SHANI_LOAD(M1, 16);
+        E1 = _mm_sha1nexte_epu32(E1, M1);
+        E0 = ABCD;
+        ABCD = _mm_sha1rnds4_epu32(ABCD, E1, 0);
+        M0 = _mm_sha1msg1_epu32(M0, M1);
+
+        SHANI_LOAD(M2, 32);
+        E0 = _mm_sha1nexte_epu32(E0, M2);
+        E1 = ABCD;
+        ABCD = _mm_sha1rnds4_epu32(ABCD, E0, 0);
+        M1 = _mm_sha1msg1_epu32(M1, M2);
+        M0 = _mm_xor_si128(M0, M2);
+
+        SHANI_LOAD(M3, 48);
+        SHANI_R4(E1, E0, M3, M0, M1, M2, 0);
+
+        /* Rounds 16-79 */
+        SHANI_R4(E0, E1, M0, M1, M2, M3, 0);
+        SHANI_R4(E1, E0, M1, M2, M3, M0, 1);
+        SHANI_R4(E0, E1, M2, M3, M0, M1, 1);
+        SHANI_R4(E1, E0, M3, M0, M1, M2, 1);
+        SHANI_R4(E0, E1, M0, M1, M2, M3, 1);
+        SHANI_R4(E1, E0, M1, M2, M3, M0, 1);
+        SHANI_R4(E0, E1, M2, M3, M0, M1, 2);
+        SHANI_R4(E1, E0, M3, M0, M1, M2, 2);
+        SHANI_R4(E0, E1, M0, M1, M2, M3, 2);
+        SHANI_R4(E1, E0, M1, M2, M3, M0, 2);
+        SHANI_R4(E0, E1, M2, M3, M0, M1, 2);
+        SHANI_R4(E1, E0, M3, M0, M1, M2, 3);
+        SHANI_R4(E0, E1, M0, M1, M2, M3, 3);
+        SHANI_R4(E1, E0, M1, M2, M3, M0, 3);
+        SHANI_R4(E0, E1, M2, M3, M0, M1, 3);
+        SHANI_R4(E1, E0, M3, M0, M1, M2, 3);
+
+        /* Add the working vars back into the state */
+        E0 = _mm_sha1nexte_epu32(E0, E0_SAVE);
+        ABCD = _mm_add_epi32(ABCD, ABCD_SAVE);
+    }
+    _mm_storeu_si128((__m128i *) state, _mm_shuffle_epi32(ABCD, 0x1B));
+    state[4] = (uint32_t) _mm_extract_epi32(E0, 3);
+}
+
+#undef SHANI_R4
+#undef SHANI_LOAD
+
+static int sha1_has_shani(void)
+{
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("sha") && __builtin_cpu_supports("sse4.1");
+}
+#endif /* SHA1_X86 */
+
+#ifdef SHA1_ARMCE
+/* ARMv8 crypto extension (AArch64, built with +crypto/+sha2).
+ * Group k covers rounds 4k..4k+3; from k = 4 on, M[k % 4] is rewritten
+ * in place from the previous 16 words by sha1su0/sha1su1. */
+
+static void SHA1Transform_armce(
+    uint32_t state[5],
+    const unsigned char buffer[64]
+)
+{
+    static const uint32_t K[4] = { 0x5A827999, 0x6ED9EBA1, 0x8F1BBCDC, 0xCA62C1D6 };
+    uint32x4_t ABCD, ABCD_SAVE, TMP;
+    uint32x4_t M[4];
+    uint32_t E, E_NEXT;
+    int k;
+
+    ABCD = vld1q_u32(state);
+    E = state[4];
+    ABCD_SAVE = ABCD;
+
+    for (k = 0; k < 4; k++)
+        M[k] = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(buffer + 16 * k)));
+
+    for (k = 0; k < 20; k++)
+    {
+        if (k >= 4)
+            M[k & 3] = vsha1su1q_u32(vsha1su0q_u32(M[k & 3], M[(k + 1) & 3], M[(k + 2) & 3]),
+                M[(k + 3) & 3]);
+        TMP = vaddq_u32(M[k & 3], vdupq_n_u32(K[k / 5]));
+        E_NEXT = vsha1h_u32(vgetq_lane_u32(ABCD, 0));
+        if (k < 5)
+            ABCD = vsha1cq_u32(ABCD, E, TMP);
+        else if (k >= 10 && k < 15)
+            ABCD = vsha1mq_u32(ABCD, E, TMP);
+        else
+            ABCD = vsha1pq_u32(ABCD, E, TMP);
+        E = E_NEXT;
+    }
+
+    vst1q_u32(state, vaddq_u32(ABCD, ABCD_SAVE));
+    state[4] += E;
+}
+
+static void SHA1Blocks_armce(
+    uint32_t state[5],
+    const unsigned char *data,
+    size_t nblocks
+)
+{
+    for (; nblocks; nblocks--, data += 64)
+        SHA1Transform_armce(state, data);
+}
+
+static int sha1_has_armce(void)
+{
+    return (getauxval(AT_HWCAP) & HWCAP_SHA1) != 0;
+}
+#endif /* SHA1_ARMCE */
+
+/* Backends in order of preference; the first one the CPU supports wins */
+static const struct
+{
+    const char *name;
+    void (*blocks)(uint32_t state[5], const unsigned char *data, size_t nblocks);
+    int (*supported)(void);
+} sha1_backends[] = {
+#ifdef SHA1_X86
+    { "shani", SHA1Blocks_shani, sha1_has_shani },
+#endif
+#ifdef SHA1_ARMCE
+    { "armce", SHA1Blocks_armce, sha1_has_armce },
+#endif
+    { "scalar", SHA1Blocks_scalar, NULL },
+    { "handsoff", SHA1Blocks_handsoff, NULL },
+};
+
+#define SHA1_NBACKENDS (sizeof(sha1_backends) / sizeof(sha1_backends[0]))
+
+/* Index into sha1_backends[]; chosen once at load time, may be replaced
+ * by SHA1SetBackend() while other threads are hashing */
+static atomic_int sha1_backend = -1;
+
+static int sha1_backend_select(void)
+{
+    unsigned i;
+
+    for (i = 0; i < SHA1_NBACKENDS; i++)
+        if (!sha1_backends[i].supported || sha1_backends[i].supported())
+            break;
+    return i;
+}
+
+/* Runs before main(); the lazy path only covers callers from other
+ * constructors, and never overwrites a SHA1SetBackend() choice */
+__attribute__((constructor))
+static void sha1_backend_init(void)
+{
+    int unset = -1;
+
+    atomic_compare_exchange_strong(&sha1_backend, &unset, sha1_backend_select());
+}
+
+static int sha1_backend_get(void)
+{
+    int i = atomic_load_explicit(&sha1_backend, memory_order_relaxed);
+
+    if (i < 0)
+    {
+        sha1_backend_init();
+        i = atomic_load(&sha1_backend);
+    }
+    return i;
+}
+
+const char *SHA1Backend(
+    void
+)
+{
+    return sha1_backends[sha1_backend_get()].name;
+}
+
+int SHA1SetBackend(
+    const char *name
+)
+{
+    unsigned i;
+
+    for (i = 0; i < SHA1_NBACKENDS; i++)
+    {
+        if (strcmp(sha1_backends[i].name, name) != 0)
+            continue;
+        if (sha1_backends[i].supported && !sha1_backends[i].supported())
+            return -1;
+        atomic_store(&sha1_backend, (int) i);
+        return 0;
+    }
+    return -1;
+}
+
+/* Runtime-dispatched SHA1Transform(); same API on every backend */
+
+void SHA1Transform(
+    uint32_t state[5],
+    const unsigned char buffer[64]
+)
+{
+    sha1_backends[sha1_backend_get()].blocks(state, buffer, 1);
+}
+
+/* Hash nblocks consecutive 64-byte blocks straight from the caller's memory */
+
+void SHA1TransformBlocks(
+    uint32_t state[5],
+    const unsigned char *data,
+    size_t nblocks
+)
+{
+    sha1_backends[sha1_backend_get()].blocks(state, data, nblocks);
+}
+
+
+/* Multi-buffer SHA1Transform: 4/8/16 messages per call on SIMD lanes.
+ * SSE2 (4 lanes) is baseline on x86-64; AVX2 (8) and AVX-512F (16) are
+ * picked at runtime. Other targets get the 4-lane kernel, which GCC maps
+ * to NEON when enabled and to plain scalar code otherwise. */
+
+#define SHA1_XN_NAME SHA1Transform_x4
+#define SHA1_XN_LANES 4
+#ifdef SHA1_X86
+#define SHA1_XN_TARGET __attribute__((target("sse2")))
+#else
+#define SHA1_XN_TARGET
+#endif
+#include "sha1_xn.h"
+#undef SHA1_XN_NAME
+#undef SHA1_XN_LANES
+#undef SHA1_XN_TARGET
+
+#ifdef SHA1_X86
+#define SHA1_XN_NAME SHA1Transform_x8
+#define SHA1_XN_LANES 8
+#define SHA1_XN_TARGET __attribute__((target("avx2")))
+#include "sha1_xn.h"
+#undef SHA1_XN_NAME
+#undef SHA1_XN_LANES
+#undef SHA1_XN_TARGET
+
+#define SHA1_XN_NAME SHA1Transform_x16
+#define SHA1_XN_LANES 16
+#define SHA1_XN_TARGET __attribute__((target("avx512f")))
+#include "sha1_xn.h"
+#undef SHA1_XN_NAME
+#undef SHA1_XN_LANES
+#undef SHA1_XN_TARGET
+#endif
+
+/* Widest kernel this CPU can run, detected once */
+static atomic_uint sha1_lanes;
+
+__attribute__((constructor))
+static void sha1_lanes_init(void)
+{
+    unsigned lanes;
+
+#ifdef SHA1_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f"))
+        lanes = 16;
+    else if (__builtin_cpu_supports("avx2"))
+        lanes = 8;
+    else
+#endif
+        lanes = 4;
+    atomic_store(&sha1_lanes, lanes);
+}
+
+unsigned SHA1Lanes(void)
+{
+    unsigned lanes = atomic_load_explicit(&sha1_lanes, memory_order_relaxed);
+
+    if (lanes == 0)
+    {
+        /* Called from another constructor: detection is idempotent */
+        sha1_lanes_init();
+        lanes = atomic_load(&sha1_lanes);
+    }
+    return lanes;
+}
+
+void SHA1Transform_xN(
+    uint32_t state[][5],
+    const unsigned char *const buffer[],
+    size_t n
+)
+{
+    size_t i = 0;
+    unsigned lanes = SHA1Lanes();
+
+#ifdef SHA1_X86
+    if (lanes >= 16)
+        for (; i + 16 <= n; i += 16)
+            SHA1Transform_x16(&state[i], &buffer[i]);
+    if (lanes >= 8)
+        for (; i + 8 <= n; i += 8)
+            SHA1Transform_x8(&state[i], &buffer[i]);
+#endif
+    for (; i + 4 <= n; i += 4)
+        SHA1Transform_x4(&state[i], &buffer[i]);
+    /* Scalar fallback for the tail */
+    for (; i < n; i++)
+        SHA1Transform(state[i], buffer[i]);
+}
+
+
 /* SHA1Init - Initialize new context */
 
 void SHA1Init(
@@ -220,12 +656,16 @@ void SHA1Update(
     j = (j >> 3) & 63;
     if ((j + len) > 63)
     {
-        memcpy(&context->buffer[j], data, (i = 64 - j));
-        SHA1Transform(context->state, context->buffer);
-        for (; i + 63 < len; i += 64)
+        i = 0;
+        if (j)
         {
-            SHA1Transform(context->state, &data[i]);
+            /* Top up the partial block first */
+            memcpy(&context->buffer[j], data, (i = 64 - j));
+            SHA1Transform(context->state, context->buffer);
         }
+        /* Fast path: all remaining full blocks in one call, no copying */
+        SHA1TransformBlocks(context->state, &data[i], (len - i) >> 6);
+        i += (len - i) & ~63u;
         j = 0;
     }
     else
@@ -245,7 +685,9 @@ void SHA1Final(
 
     unsigned char finalcount[8];
 
-    unsigned char c;
+    static const unsigned char padding[64] = { 0200 };
+
+    uint32_t r;
 
 #if 0    /* untested "improvement" by DHR */
     /* Convert context->count to a sequence of bytes
@@ -269,13 +711,9 @@ void SHA1Final(
         finalcount[i] = (unsigned char) ((context->count[(i >= 4 ? 0 : 1)] >> ((3 - (i & 3)) * 8)) & 255);      /* Endian independent */
     }
 #endif
-    c = 0200;
-    SHA1Update(context, &c, 1);
-    while ((context->count[0] & 504) != 448)
-    {
-        c = 0000;
-        SHA1Update(context, &c, 1);
-    }
+    /* 0x80 then zeros up to 56 mod 64, in one update */
+    r = (context->count[0] >> 3) & 63;
+    SHA1Update(context, padding, r < 56 ? 56 - r : 120 - r);
     SHA1Update(context, finalcount, 8); /* Should cause a SHA1Transform() */
     for (i = 0; i < 20; i++)
     {
@@ -293,10 +731,64 @@ void SHA1(
     uint32_t len)
 {
     SHA1_CTX ctx;
-    unsigned int ii;
 
     SHA1Init(&ctx);
-    for (ii=0; ii<len; ii+=1)
-        SHA1Update(&ctx, (const unsigned char*)str + ii, 1);
+    SHA1Update(&ctx, (const unsigned char*)str, len);
     SHA1Final((unsigned char *)hash_out, &ctx);
+}
+
+/* Hash a whole file. Regular files are mmap()ed and hashed in place;
+ * anything that cannot be mapped (pipes, /proc, empty files, files larger
+ * than the address space) is read(). */
+
+int SHA1File(
+    unsigned char digest[20],
+    const char *path)
+{
+    SHA1_CTX ctx;
+    struct stat st;
+    int fd;
+
+    fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return -1;
+    SHA1Init(&ctx);
+    /* On 32-bit targets off_t can exceed size_t: such files are read() */
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0 &&
+        (uint64_t) st.st_size <= SIZE_MAX)
+    {
+        size_t size = (size_t) st.st_size;
+        const unsigned char *map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+        if (map != MAP_FAILED)
+        {
+            size_t off;
+
+            madvise((void *) map, size, MADV_SEQUENTIAL);
+            /* SHA1Update() takes 32-bit lengths */
+            for (off = 0; off < size; off += 1u << 30)
+                SHA1Update(&ctx, map + off, size - off < (1u << 30) ? size - off : 1u << 30);
+            munmap((void *) map, size);
+            close(fd);
+            SHA1Final(digest, &ctx);
+            return 0;
+        }
+    }
+    for (;;)
+    {
+        unsigned char buf[65536];
+        ssize_t n = read(fd, buf, sizeof(buf));
+
+        if (n < 0)
+        {
+            close(fd);
+            return -1;
+        }
+        if (n == 0)
+            break;
+        SHA1Update(&ctx, buf, (uint32_t) n);
+    }
+    close(fd);
+    SHA1Final(digest, &ctx);
+    return 0;
 }
\ No newline at end of file
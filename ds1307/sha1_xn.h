@@ -0,0 +1,83 @@
+/*
+ * Multi-buffer SHA-1 block kernel, included by sha1.c once per lane width.
+ *
+ * Before including, define:
+ *   SHA1_XN_NAME    name of the generated function
+ *   SHA1_XN_LANES   number of 32-bit lanes (4, 8 or 16)
+ *   SHA1_XN_TARGET  function attributes (e.g. target("avx2")), may be empty
+ *
+ * The generated function hashes one 64-byte block for each of SHA1_XN_LANES
+ * independent messages. Lane j reads buffer[j] and updates state[j]; the
+ * rounds are the same R0..R4 as SHA1Transform(), on GCC vector types.
+ */
+
+#define XROL(v, bits) (((v) << (bits)) | ((v) >> (32 - (bits))))
+#define XBLK(i) (W[(i)&15] = XROL(W[((i)+13)&15]^W[((i)+8)&15]^W[((i)+2)&15]^W[(i)&15],1))
+
+#define XR0(v,w,x,y,z,i) z+=((w&(x^y))^y)+W[(i)]+0x5A827999+XROL(v,5);w=XROL(w,30);
+#define XR1(v,w,x,y,z,i) z+=((w&(x^y))^y)+XBLK(i)+0x5A827999+XROL(v,5);w=XROL(w,30);
+#define XR2(v,w,x,y,z,i) z+=(w^x^y)+XBLK(i)+0x6ED9EBA1+XROL(v,5);w=XROL(w,30);
+#define XR3(v,w,x,y,z,i) z+=(((w|x)&y)|(w&x))+XBLK(i)+0x8F1BBCDC+XROL(v,5);w=XROL(w,30);
+#define XR4(v,w,x,y,z,i) z+=(w^x^y)+XBLK(i)+0xCA62C1D6+XROL(v,5);w=XROL(w,30);
+
+/* Five rounds rotate the working variables back into place */
+#define XR5(R,i) \
+    R(a, b, c, d, e, i); R(e, a, b, c, d, i + 1); R(d, e, a, b, c, i + 2); \
+    R(c, d, e, a, b, i + 3); R(b, c, d, e, a, i + 4);
+
+SHA1_XN_TARGET
+static void SHA1_XN_NAME(
+    uint32_t state[][5],
+    const unsigned char *const buffer[]
+)
+{
+    typedef uint32_t vec_t __attribute__((vector_size(SHA1_XN_LANES * 4)));
+    vec_t a, b, c, d, e;
+    vec_t W[16];
+    int i, j;
+
+    /* Transpose: word i of every lane's block into one vector */
+    for (i = 0; i < 16; i++)
+        for (j = 0; j < SHA1_XN_LANES; j++)
+        {
+            const unsigned char *p = buffer[j] + 4 * i;
+
+            W[i][j] = ((uint32_t) p[0] << 24) | ((uint32_t) p[1] << 16) |
+                ((uint32_t) p[2] << 8) | (uint32_t) p[3];
+        }
+    for (j = 0; j < SHA1_XN_LANES; j++)
+    {
+        a[j] = state[j][0];
+        b[j] = state[j][1];
+        c[j] = state[j][2];
+        d[j] = state[j][3];
+        e[j] = state[j][4];
+    }
+
+    XR5(XR0, 0); XR5(XR0, 5); XR5(XR0, 10);
+    XR0(a, b, c, d, e, 15); XR1(e, a, b, c, d, 16); XR1(d, e, a, b, c, 17);
+    XR1(c, d, e, a, b, 18); XR1(b, c, d, e, a, 19);
+    XR5(XR2, 20); XR5(XR2, 25); XR5(XR2, 30); XR5(XR2, 35);
+    XR5(XR3, 40); XR5(XR3, 45); XR5(XR3, 50); XR5(XR3, 55);
+    XR5(XR4, 60); XR5(XR4, 65); XR5(XR4, 70); XR5(XR4, 75);
+
+    for (j = 0; j < SHA1_XN_LANES; j++)
+    {
+        state[j][0] += a[j];
+        state[j][1] += b[j];
+        state[j][2] += c[j];
+        state[j][3] += d[j];
+        state[j][4] += e[j];
+    }
+    /* Wipe variables */
+    memset(W, '\0', sizeof(W));
+}
+
+#undef XR5
+#undef XR4
+#undef XR3
+#undef XR2
+#undef XR1
+#undef XR0
+#undef XBLK
+#undef XROL
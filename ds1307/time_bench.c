@@ -0,0 +1,103 @@
+// Benchmark doc thoi gian tu /dev/rtc_time: ioctl so voi trang mmap (chay tren BBB)
+// Build: gcc -O2 -o time_bench time_bench.c
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include "ds1307_ioctl.h"
+
+#define DEVICE_FILE "/dev/rtc_time"
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Lenh cu: chi tra ve so giay trong ngay
+static double bench_ioctl_int(int fd, long iters) {
+    volatile int sink = 0;
+    int secs;
+    double t0 = now_sec();
+
+    for (long i = 0; i < iters; i++) {
+        if (ioctl(fd, GET_TIME_CMD, &secs) < 0) {
+            perror("ioctl GET_TIME_CMD");
+            exit(1);
+        }
+        sink ^= secs;
+    }
+    (void)sink;
+    return now_sec() - t0;
+}
+
+static double bench_ioctl_snapshot(int fd, long iters) {
+    volatile uint32_t sink = 0;
+    struct ds1307_time t;
+    double t0 = now_sec();
+
+    for (long i = 0; i < iters; i++) {
+        if (ioctl(fd, GET_SNAPSHOT_CMD, &t) < 0) {
+            perror("ioctl GET_SNAPSHOT_CMD");
+            exit(1);
+        }
+        sink ^= t.sec;
+    }
+    (void)sink;
+    return now_sec() - t0;
+}
+
+// Khong co syscall: doc truc tiep trang chia se, thu lai khi kernel dang ghi
+static double bench_mmap(const struct ds1307_time_page *pg, long iters) {
+    volatile uint32_t sink = 0;
+    struct ds1307_time t;
+    double t0 = now_sec();
+
+    for (long i = 0; i < iters; i++) {
+        ds1307_time_page_read(pg, &t);
+        sink ^= t.sec;
+    }
+    (void)sink;
+    return now_sec() - t0;
+}
+
+int main(int argc, char *argv[]) {
+    long iters = argc > 1 ? atol(argv[1]) : 10000000;
+    const struct ds1307_time_page *pg;
+    struct ds1307_time t;
+    double t_int, t_snap, t_mmap;
+    int fd;
+
+    fd = open(DEVICE_FILE, O_RDONLY);
+    if (fd < 0) {
+        perror("open " DEVICE_FILE);
+        return 1;
+    }
+    pg = mmap(NULL, 4096, PROT_READ, MAP_SHARED, fd, 0);
+    if (pg == MAP_FAILED) {
+        perror("mmap " DEVICE_FILE);
+        return 1;
+    }
+
+    ds1307_time_page_read(pg, &t);
+    printf("Trang mmap: %04u-%02u-%02u %02u:%02u:%02u (generation %u)\n",
+           t.year, t.mon, t.mday, t.hour, t.min, t.sec, t.generation);
+
+    printf("== %ld lan doc ==\n", iters);
+    t_int = bench_ioctl_int(fd, iters);
+    t_snap = bench_ioctl_snapshot(fd, iters);
+    t_mmap = bench_mmap(pg, iters);
+
+    printf("ioctl(GET_TIME_CMD):     %8.1f ns/lan\n", t_int / iters * 1e9);
+    printf("ioctl(GET_SNAPSHOT_CMD): %8.1f ns/lan\n", t_snap / iters * 1e9);
+    printf("mmap:                    %8.1f ns/lan   x%.1f so voi GET_SNAPSHOT_CMD\n",
+           t_mmap / iters * 1e9, t_snap / t_mmap);
+
+    munmap((void *)pg, 4096);
+    close(fd);
+    return 0;
+}
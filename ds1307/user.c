@@ -11,37 +11,58 @@
 #include <stdint.h> 
 #include "otp.h"  
 #include "sha1.h" 
+#include "ds1307_ioctl.h"
 
 // Định nghĩa IOCTL, FIFO và Device (Giữ nguyên)
-#define DELAY_SECONDS 30
 #define FIFO_PATH "/tmp/my_data_fifo"
 #define DEVICE_FILE "/dev/rtc_time" 
-#define LED_IOC_MAGIC 'k' 
-#define GET_TIME_CMD _IOR(LED_IOC_MAGIC, 1, int) 
 
 
 uint8_t secret_key[] = "12345678901234567890";
+static otp_key_ctx key_ctx; // HMAC key schedule, dung lai cho moi lan tinh OTP
 
 
 
+// Doi ngay gio cua DS1307 (UTC) sang Unix time
+static int64_t snapshot_to_unix(const struct ds1307_time* t) {
+    struct tm tm;
+
+    memset(&tm, 0, sizeof(tm));
+    tm.tm_year = t->year - 1900;
+    tm.tm_mon = t->mon - 1;
+    tm.tm_mday = t->mday;
+    tm.tm_hour = t->hour;
+    tm.tm_min = t->min;
+    tm.tm_sec = t->sec;
+    return (int64_t)timegm(&tm);
+}
+
+// Lay thoi gian tu kernel: lan dau dung ioctl (tra ve ngay), sau do
+// block tren read() cho den khi driver bao thoi gian da doi
+static int get_snapshot(int device_fd, int block, struct ds1307_time* snapshot) {
+    if (!block) {
+        if (ioctl(device_fd, GET_SNAPSHOT_CMD, snapshot) < 0) {
+            perror("IOCTL GET_SNAPSHOT_CMD failed");
+            return -1;
+        }
+        return 0;
+    }
+    if (read(device_fd, snapshot, sizeof(*snapshot)) != sizeof(*snapshot)) {
+        perror("read " DEVICE_FILE " failed");
+        return -1;
+    }
+    return 0;
+}
+
 // Hàm xử lý đọc dữ liệu
-void read_time_from_kernel(int device_fd) {
-    int unix_time = 0; // Kernel side sẽ trả về tổng giây
+void read_time_from_kernel(int64_t unix_time) {
     int otpcode = 0; 
     int fifo_fd; // Biến fd cho FIFO, KHÔNG phải device
     int ret; 
 
-    // 1. GỌI IOCTL: Lệnh ĐỌC (READ - GET_TIME_CMD)
-    // SỬA: Sử dụng device_fd cho ioctl
-    if (ioctl(device_fd, GET_TIME_CMD, &unix_time) < 0) {
-        perror("IOCTL GET_TIME_CMD failed");
-        printf("Loi: Khong the doc du lieu tu kernel.\n");
-        return; // Thoát nếu IOCTL lỗi
-    } 
-    
     // 2. Tinh toan OTP (Phải chia cho 30s)
     // SỬA: Sử dụng thời gian nhận được từ kernel
-    otpcode = totp(secret_key, sizeof(secret_key) - 1, (int)(unix_time / 30), 6);
+    otpcode = hotp_ctx(&key_ctx, totp_step(unix_time, 0, step), 6);
 
     // 3. Mo FIFO va Gui du lieu
     // Mở FIFO chỉ để ghi (nó sẽ block nếu không có reader)
@@ -57,7 +78,7 @@ void read_time_from_kernel(int device_fd) {
 
     if (ret == sizeof(otpcode)) {
         printf("C Sender: Gui OTP THANH CONG.\n");
-        printf("[SUCCESS] Tong Giay: %d, OTP code: %d\n", unix_time, otpcode);
+        printf("[SUCCESS] Unix time: %lld, OTP code: %d\n", (long long)unix_time, otpcode);
     } else {
         perror("Error during write to FIFO");
     }
@@ -66,6 +87,8 @@ void read_time_from_kernel(int device_fd) {
 
 int main() {
     int device_fd;
+    int block = 0;
+    uint64_t last_step = UINT64_MAX;
     
     // 1. Tạo Named Pipe (FIFO)
     if (mkfifo(FIFO_PATH, 0666) == -1 && errno != EEXIST) {
@@ -81,16 +104,33 @@ int main() {
         return 1;
     }
     
-    printf("Userspace TOTP Logger started. Logging every %d seconds.\n", DELAY_SECONDS);
+    otp_key_init(&key_ctx, secret_key, sizeof(secret_key) - 1);
+
+    printf("Userspace TOTP Logger started. Logging every %d-second TOTP step.\n", step);
 
-    // 3. Vòng lặp chính
+    // 3. Vòng lặp chính: khong sleep, read() tu block den lan doi thoi gian
+    // tiep theo (moi giay, hoac moi 30 s neu nap module voi wake_period=30)
     while (1)
     {
+        struct ds1307_time snapshot;
+        int64_t unix_time;
+        uint64_t cur_step;
+
+        if (get_snapshot(device_fd, block, &snapshot) < 0) {
+            printf("Loi: Khong the doc du lieu tu kernel.\n");
+            sleep(1);
+            continue;
+        }
+        block = 1;
+
+        unix_time = snapshot_to_unix(&snapshot);
+        cur_step = totp_step(unix_time, 0, step);
+        if (cur_step == last_step)
+            continue; // van trong buoc TOTP cu
+        last_step = cur_step;
+
         printf("---------------------------------------------------\n");
-        read_time_from_kernel(device_fd); // Truyen fd cua device
-        
-        // Ngủ (sleep) 30 giây để đồng bộ với bước nhảy của TOTP
-        sleep(DELAY_SECONDS);
+        read_time_from_kernel(unix_time);
     }
     
 
@@ -33,6 +33,17 @@ int oled_write_2byte_cmd(struct i2c_client *client, u8 *cmd);
 // Hàm gửi dữ liệu 1 byte
 int oled_write_data(struct i2c_client *client, u8 data);
 
+// Gui ca danh sach lenh (toi da OLED_CMD_BATCH_MAX byte) trong mot transaction
+#define OLED_CMD_BATCH_MAX 32
+int oled_write_cmds(struct i2c_client *client, const u8 *cmds, int n);
+
+// Dat cua so ghi cot/trang (lenh 0x21/0x22)
+int oled_set_window(struct i2c_client *client, u8 col_lo, u8 col_hi,
+                    u8 page_lo, u8 page_hi);
+
+// Dat do tuong phan 0..255 (lenh 0x81)
+int oled_set_contrast(struct i2c_client *client, u8 level);
+
 
 // --- API Điều khiển OLED cấp cao ---
 
@@ -51,6 +62,9 @@ void oled_print(struct i2c_client *client, u8 *str);
 // Hiển thị chuỗi tại vị trí (Trang Ypos, Cột Xpos)
 void oled_msg(struct i2c_client *client, u8 Ypos, u8 Xpos, u8 *str);
 
+// Gui cac cot da thay doi cua shadow framebuffer (moi trang dirty = 1 transfer)
+int oled_fb_flush(struct i2c_client *client);
+
 
 static const u8 ASCII[][5] =
 {
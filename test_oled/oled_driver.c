@@ -13,6 +13,20 @@
 #include <linux/fs.h>
 #include <linux/device.h>
 #include <linux/time.h>
+#include <linux/mutex.h>
+#include <linux/debugfs.h>
+#include <linux/ktime.h>
+#include <linux/fb.h>
+#include <linux/interrupt.h>
+#include <linux/wait.h>
+#include <linux/atomic.h>
+
+/* /dev/fbN (oled_fbdev_register) dung fb_deferred_io va cac helper fb_sys_* */
+#if !IS_ENABLED(CONFIG_FB_DEFERRED_IO) || !IS_ENABLED(CONFIG_FB_SYS_FOPS) || \
+    !IS_ENABLED(CONFIG_FB_SYS_FILLRECT) || !IS_ENABLED(CONFIG_FB_SYS_COPYAREA) || \
+    !IS_ENABLED(CONFIG_FB_SYS_IMAGEBLIT)
+#error "oled_driver needs CONFIG_FB_DEFERRED_IO and CONFIG_FB_SYS_{FOPS,FILLRECT,COPYAREA,IMAGEBLIT} in the target kernel"
+#endif
 
 // Tên driver này PHẢI KHỚP với tên trong id_table
 #define DRIVER_NAME "combined-i2c-driver"
@@ -32,10 +46,76 @@ static int time; //gio phut giay -> giay;
 #define LED_IOC_MAGIC 'k'
 #define GET_TIME_CMD _IOR(LED_IOC_MAGIC, 1, int)
 
+/*
+ * Shadow framebuffer: ve vao RAM truoc, oled_fb_flush() chi gui cac cot da
+ * thay doi. Moi trang (8 hang pixel) giu mot khoang cot ban [lo, hi].
+ */
+static struct {
+    struct mutex lock;
+    u8 buf[OLED_PAGES][OLED_WIDTH];
+    short dirty_lo[OLED_PAGES];   /* OLED_WIDTH = trang sach */
+    short dirty_hi[OLED_PAGES];   /* -1 = trang sach */
+    u8 cur_page, cur_col;         /* con tro cho oled_print() */
+    u8 xfer[1 + OLED_PAGES * OLED_WIDTH]; /* 0x40 + du lieu, dung duoi lock */
+    bool clock_running;           /* thread dong ho dang giu trang OLED_CLOCK_PAGE */
+} oled_fb;
+
+/* So transaction va byte da gui toi OLED, xem trong /sys/kernel/debug/ssd1306/ */
+static struct {
+    u64 xfers;
+    u64 bytes;
+} oled_stats;
+static struct dentry *oled_debugfs;
+static u8 oled_contrast = 0x7F;   /* gia tri oled_hw_init() dat */
+
+/*
+ * Dong ho tren trang 4: nho chuoi da ve de chi ve lai cac ky tu doi.
+ * Neu chan SQW cua DS1307 noi vao GPIO (client->irq trong DT), moi canh
+ * xuong 1 Hz (ngay sau khi thanh ghi giay nhay) danh thuc thread ve.
+ * Khong co IRQ thi ngu ~1 s roi doc thu moi OLED_CLOCK_POLL_US cho toi canh,
+ * toi da OLED_CLOCK_MAX_READS lan doc moi giay.
+ */
+#define OLED_CLOCK_PAGE      4
+#define OLED_CLOCK_POLL_US   5000
+#define OLED_CLOCK_GUARD_MS  (10 + 2 * 1000 / HZ) /* msleep() co the tre ~2 jiffy */
+#define OLED_CLOCK_MAX_READS 10
+static char oled_clock_last[9];   /* "" = chua ve gi */
+
+#define DS1307_REG_CONTROL 0x07
+#define DS1307_SQW_1HZ     0x10   /* SQWE=1, RS=00 */
+static bool rtc_sqw_irq;          /* true: background_task cho ngat SQW */
+static atomic_t rtc_tick = ATOMIC_INIT(0);
+static DECLARE_WAIT_QUEUE_HEAD(rtc_tick_wq);
+
+/*
+ * /dev/fbN: framebuffer 1bpp 128x64 (16 byte/hang, bit 0 = pixel trai nhat).
+ * Ung dung mmap/ghi vao vmem; fb_deferred_io gom cac lan ghi trong mot chu ky
+ * roi goi oled_fb_deferred_io() -> doi sang trang SSD1306 + mot lan flush.
+ */
+#define OLED_FB_LINE    (OLED_WIDTH / 8)
+#define OLED_FB_SIZE    (OLED_FB_LINE * OLED_HEIGHT)
+
+static unsigned int fb_fps = 20;
+module_param(fb_fps, uint, 0444);
+MODULE_PARM_DESC(fb_fps, "Max /dev/fbN refresh rate in frames per second (default 20)");
+
+static struct fb_info *oled_fb_info;
+
+/* Moi lan gui toi OLED deu di qua day de dem */
+static int oled_send(struct i2c_client *client, const u8 *buf, int len)
+{
+    int ret = i2c_master_send(client, buf, len);
+
+    oled_stats.xfers++;
+    if (ret > 0)
+        oled_stats.bytes += ret;
+    return ret;
+}
+
 int oled_write_cmd(struct i2c_client *client, u8 cmd)
 {
     u8 buf[2] = {0x00, cmd};
-    int ret = i2c_master_send(client, buf, 2);
+    int ret = oled_send(client, buf, 2);
     if (ret != 2) {
         dev_err(&client->dev, "Failed to send command 0x%02x: %d\n", cmd, ret);
         return (ret < 0) ? ret : -EIO;
@@ -46,7 +126,7 @@ int oled_write_cmd(struct i2c_client *client, u8 cmd)
 int oled_write_2byte_cmd(struct i2c_client *client, u8 *cmd)
 {
     u8 buf[3] = {0x00, cmd[0], cmd[1]};
-    int ret = i2c_master_send(client, buf, 3);
+    int ret = oled_send(client, buf, 3);
     if (ret != 3) {
         dev_err(&client->dev, "Failed to send 2-byte command 0x%02x 0x%02x: %d\n",
                 cmd[0], cmd[1], ret);
@@ -58,7 +138,7 @@ int oled_write_2byte_cmd(struct i2c_client *client, u8 *cmd)
 int oled_write_data(struct i2c_client *client, u8 data)
 {
     u8 buf[2] = {0x40, data};
-    int ret = i2c_master_send(client, buf, 2);
+    int ret = oled_send(client, buf, 2);
     if (ret != 2) {
         dev_err(&client->dev, "Failed to send data 0x%02x: %d\n", data, ret);
         return (ret < 0) ? ret : -EIO;
@@ -66,90 +146,319 @@ int oled_write_data(struct i2c_client *client, u8 data)
     return 0;
 }
 
+/*
+ * So byte toi da sau control byte trong mot transaction ghi, theo
+ * i2c_adapter_quirks (max_write_len = 0: khong gioi han). Chi dung message ghi
+ * don nen max_comb_* khong ap dung; moi transaction co it nhat 2 byte nen
+ * I2C_AQ_NO_ZERO_LEN_WRITE cung khong bi cham. -EOPNOTSUPP neu khong chua
+ * noi 1 byte payload.
+ */
+static int oled_max_payload(struct i2c_client *client)
+{
+    const struct i2c_adapter_quirks *q = client->adapter->quirks;
+
+    if (!q || !q->max_write_len)
+        return INT_MAX;
+    if (q->max_write_len < 2)
+        return -EOPNOTSUPP;
+    return q->max_write_len - 1;
+}
+
+/*
+ * Sau mot control byte 0x00, SSD1306 nhan mot chuoi lenh lien tiep: gui ca
+ * danh sach cmds (lenh + tham so) trong MOT transaction I2C.
+ */
+int oled_write_cmds(struct i2c_client *client, const u8 *cmds, int n)
+{
+    u8 buf[1 + OLED_CMD_BATCH_MAX];
+    int ret;
+
+    if (n <= 0 || n > OLED_CMD_BATCH_MAX)
+        return -EINVAL;
+    // Lenh va tham so khong duoc tach qua hai transaction
+    ret = oled_max_payload(client);
+    if (ret >= 0 && n > ret)
+        ret = -EOPNOTSUPP;
+    if (ret < 0)
+        return ret;
+    buf[0] = 0x00;
+    memcpy(&buf[1], cmds, n);
+    ret = oled_send(client, buf, n + 1);
+    if (ret != n + 1) {
+        dev_err(&client->dev, "Failed to send %d-byte command batch (0x%02x...): %d\n",
+                n, cmds[0], ret);
+        return (ret < 0) ? ret : -EIO;
+    }
+    return 0;
+}
+
+// Dat cua so ghi [col_lo..col_hi] x [page_lo..page_hi] (che do dia chi ngang)
+int oled_set_window(struct i2c_client *client, u8 col_lo, u8 col_hi,
+                    u8 page_lo, u8 page_hi)
+{
+    const u8 cmds[] = {
+        0x21, col_lo, col_hi,   // Column address
+        0x22, page_lo, page_hi, // Page address
+    };
+
+    return oled_write_cmds(client, cmds, ARRAY_SIZE(cmds));
+}
+
+int oled_set_contrast(struct i2c_client *client, u8 level)
+{
+    const u8 cmds[] = {0x81, level};
+
+    return oled_write_cmds(client, cmds, ARRAY_SIZE(cmds));
+}
+
 int oled_hw_init(struct i2c_client *client)
 {
-    int ret, i;
-    u8 cmd[][2] = {
-        {0xA8, 0x3F}, // Multiplex ratio: 64
-        {0xD3, 0x00}, // Display offset: 0
-        {0xDA, 0x12}, // COM pins configuration
-        {0x81, 0x7F}, // Contrast control
-        {0xD5, 0x80}, // Display clock divide
-        {0x8D, 0x14}, // Charge pump
-        {0x20, 0x00}, // Memory addressing mode: horizontal
+    int ret;
+    const u8 cmds[] = {
+        0xA8, 0x3F, // Multiplex ratio: 64
+        0xD3, 0x00, // Display offset: 0
+        0xDA, 0x12, // COM pins configuration
+        0x81, 0x7F, // Contrast control
+        0xD5, 0x80, // Display clock divide
+        0x8D, 0x14, // Charge pump
+        0x20, 0x00, // Memory addressing mode: horizontal
+        0x40,       // Display start line: 0
+        0xA1,       // Segment remap
+        0xC8,       // COM scan direction: remapped
+        0xA4,       // Display follows RAM
+        0xA6,       // Normal (not inverted)
+        0xAF,       // Display on
     };
-    u8 single_cmds[] = {0x40, 0xA1, 0xC8, 0xA4, 0xA6, 0xAF};
 
-    for (i = 0; i < ARRAY_SIZE(cmd); i++) {
-        ret = oled_write_2byte_cmd(client, cmd[i]);
-        if (ret < 0)
-            return ret;
+    ret = oled_write_cmds(client, cmds, ARRAY_SIZE(cmds));
+    if (ret < 0)
+        return ret;
+    msleep(100); // Delay sau init để ổn định
+    return 0;
+}
+
+static void oled_fb_mark(u8 page, int lo, int hi)
+{
+    if (lo < oled_fb.dirty_lo[page])
+        oled_fb.dirty_lo[page] = lo;
+    if (hi > oled_fb.dirty_hi[page])
+        oled_fb.dirty_hi[page] = hi;
+}
+
+/* Ghi mot byte vao framebuffer; chi danh dau dirty khi gia tri thuc su doi */
+static void oled_fb_put(u8 page, u8 col, u8 val)
+{
+    if (oled_fb.buf[page][col] == val)
+        return;
+    oled_fb.buf[page][col] = val;
+    oled_fb_mark(page, col, col);
+}
+
+/* Sau khi init/blank phan cung, framebuffer la 0 va khop voi man hinh */
+static void oled_fb_reset(void)
+{
+    int i;
+
+    memset(oled_fb.buf, 0, sizeof(oled_fb.buf));
+    for (i = 0; i < OLED_PAGES; i++) {
+        oled_fb.dirty_lo[i] = OLED_WIDTH;
+        oled_fb.dirty_hi[i] = -1;
     }
-    for (i = 0; i < ARRAY_SIZE(single_cmds); i++) {
-        ret = oled_write_cmd(client, single_cmds[i]);
-        if (ret < 0)
-            return ret;
+    oled_fb.cur_page = 0;
+    oled_fb.cur_col = 0;
+    oled_clock_last[0] = '\0';
+}
+
+static void oled_fb_clear_page(u8 page)
+{
+    int i;
+
+    for (i = 0; i < OLED_WIDTH; i++)
+        oled_fb_put(page, i, 0x00);
+    if (page == OLED_CLOCK_PAGE)
+        oled_clock_last[0] = '\0';
+}
+
+/* Ve mot ky tu (5 cot + 1 cot trong) tai (page, col) */
+static void oled_fb_glyph(u8 page, u8 col, u8 c)
+{
+    int j;
+
+    if (c < 32 || c > 127)
+        c = '?';
+    for (j = 0; j < 5; j++)
+        oled_fb_put(page, col + j, ASCII[c - 32][j]);
+    oled_fb_put(page, col + 5, 0x00); // Space between chars
+}
+
+/* Ve chuoi vao framebuffer tai con tro hien tai, 6 cot moi ky tu */
+static void oled_fb_text(const u8 *str)
+{
+    int i;
+
+    for (i = 0; str[i] && oled_fb.cur_col + 6 <= OLED_WIDTH; i++) {
+        oled_fb_glyph(oled_fb.cur_page, oled_fb.cur_col, str[i]);
+        oled_fb.cur_col += 6;
+    }
+}
+
+/*
+ * Ve str tai (page, col) nhung chi cac ky tu khac voi last (chuoi ve lan
+ * truoc o cung vi tri), roi cap nhat last. Ky tu thua cua last bi xoa.
+ */
+static void oled_fb_text_diff(u8 page, u8 col, const char *str,
+                              char *last, size_t last_size)
+{
+    size_t i;
+    int x;
+
+    for (i = 0; i < last_size - 1 && (str[i] || last[i]); i++) {
+        x = col + 6 * i;
+        if (x + 6 > OLED_WIDTH)
+            break;
+        if (str[i] == last[i])
+            continue;
+        if (str[i]) {
+            oled_fb_glyph(page, x, str[i]);
+        } else {
+            int j;
+
+            for (j = 0; j < 6; j++)
+                oled_fb_put(page, x + j, 0x00);
+        }
+    }
+    strscpy(last, str, last_size);
+}
+
+/*
+ * Gui len byte du lieu GDDRAM voi it transaction nhat ma adapter cho phep:
+ * moi transaction = 0x40 + toi da oled_max_payload() byte.
+ * Goi khi dang giu oled_fb.lock (dung oled_fb.xfer).
+ */
+static int oled_write_data_buf(struct i2c_client *client, const u8 *data, int len)
+{
+    int chunk = oled_max_payload(client), n, ret;
+
+    if (chunk < 0) {
+        dev_err_ratelimited(&client->dev, "Adapter max_write_len too small for data\n");
+        return chunk;
+    }
+
+    oled_fb.xfer[0] = 0x40;
+    while (len > 0) {
+        n = min(len, chunk);
+        memcpy(&oled_fb.xfer[1], data, n);
+        ret = oled_send(client, oled_fb.xfer, n + 1);
+        if (ret != n + 1) {
+            dev_err(&client->dev, "Failed to send %d data bytes: %d\n", n, ret);
+            return (ret < 0) ? ret : -EIO;
+        }
+        data += n;
+        len -= n;
     }
-    msleep(100); // Delay sau init để ổn định
     return 0;
 }
 
-void oled_blank(struct i2c_client *client)
+/*
+ * Ca man hinh: dat cua so 128x8 trang mot lan, che do dia chi ngang tu xuong
+ * dong, roi stream 1024 byte (1 transaction neu adapter cho phep).
+ */
+static int oled_fb_flush_full(struct i2c_client *client)
 {
     int i, ret;
-    u8 buf[OLED_WIDTH + 1];
-    buf[0] = 0x40;
-    for (i = 1; i <= OLED_WIDTH; i++)
-        buf[i] = 0x00;
 
+    ret = oled_set_window(client, 0, OLED_WIDTH - 1, 0, OLED_PAGES - 1);
+    if (ret < 0)
+        return ret;
+    ret = oled_write_data_buf(client, &oled_fb.buf[0][0], sizeof(oled_fb.buf));
+    if (ret < 0)
+        return ret;
     for (i = 0; i < OLED_PAGES; i++) {
-        oled_write_cmd(client, 0xB0 + i);
-        oled_write_cmd(client, 0x00);
-        oled_write_cmd(client, 0x10);
-        ret = i2c_master_send(client, buf, OLED_WIDTH + 1);
-        if (ret != OLED_WIDTH + 1) {
-            dev_err(&client->dev, "Failed to blank page %d: %d\n", i, ret);
+        oled_fb.dirty_lo[i] = OLED_WIDTH;
+        oled_fb.dirty_hi[i] = -1;
+    }
+    return 0;
+}
+
+/*
+ * Gui cac cot dirty: moi trang dirty ton mot batch lenh dat cua so va DUNG MOT
+ * transfer du lieu 0x40 cho ca khoang [lo, hi], thay vi 1 transfer 2 byte moi cot.
+ */
+int oled_fb_flush(struct i2c_client *client)
+{
+    int page, lo, len, ret, err = 0;
+    int dirty = 0;
+
+    /*
+     * Moi trang dirty ton them ~8 byte (batch cua so + control byte). Khi
+     * tong chi phi tung trang khong re hon ca khung thi gui ca khung.
+     */
+    for (page = 0; page < OLED_PAGES; page++)
+        if (oled_fb.dirty_hi[page] >= oled_fb.dirty_lo[page])
+            dirty += oled_fb.dirty_hi[page] - oled_fb.dirty_lo[page] + 1 + 8;
+    if (dirty >= sizeof(oled_fb.buf))
+        return oled_fb_flush_full(client);
+
+    for (page = 0; page < OLED_PAGES; page++) {
+        if (oled_fb.dirty_hi[page] < oled_fb.dirty_lo[page])
+            continue;
+        lo = oled_fb.dirty_lo[page];
+        len = oled_fb.dirty_hi[page] - lo + 1;
+
+        ret = oled_set_window(client, lo, lo + len - 1, page, page);
+        if (ret < 0) {
+            err = ret;
+            continue;
         }
+        ret = oled_write_data_buf(client, &oled_fb.buf[page][lo], len);
+        if (ret < 0) {
+            err = ret;
+            continue; /* giu dirty de lan sau gui lai */
+        }
+        oled_fb.dirty_lo[page] = OLED_WIDTH;
+        oled_fb.dirty_hi[page] = -1;
     }
+    return err;
+}
+
+void oled_blank(struct i2c_client *client)
+{
+    mutex_lock(&oled_fb.lock);
+    /* Man hinh co the dang khac framebuffer (vd. vua init): ep gui ca khung */
+    memset(oled_fb.buf, 0, sizeof(oled_fb.buf));
+    oled_clock_last[0] = '\0';
+    oled_fb_flush_full(client);
+    mutex_unlock(&oled_fb.lock);
 }
 
 void oled_clear_page(struct i2c_client *client, u8 page)
 {
-    int ret;
-    int i; 
-    u8 buf[OLED_WIDTH + 1];
-    buf[0] = 0x40;
-    for (i = 1; i <= OLED_WIDTH; i++)
-        buf[i] = 0x00;
-
-    oled_write_cmd(client, 0xB0 + page);
-    oled_write_cmd(client, 0x00);
-    oled_write_cmd(client, 0x10);
-    ret = i2c_master_send(client, buf, OLED_WIDTH + 1);
-    if (ret != OLED_WIDTH + 1) {
-        dev_err(&client->dev, "Failed to clear page %d: %d\n", page, ret);
-    }
+    if (page >= OLED_PAGES)
+        return;
+    mutex_lock(&oled_fb.lock);
+    oled_fb_clear_page(page);
+    oled_fb_flush(client);
+    mutex_unlock(&oled_fb.lock);
 }
 
 void oled_print(struct i2c_client *client, u8 *str)
 {
-    int i, j;
-    for (i = 0; str[i] && i < (OLED_WIDTH / 6); i++) {
-        for (j = 0; j < 5; j++) {
-            oled_write_data(client, ASCII[str[i] - 32][j]);
-        }
-        oled_write_data(client, 0x00); // Space between chars
-    }
+    mutex_lock(&oled_fb.lock);
+    oled_fb_text(str);
+    oled_fb_flush(client);
+    mutex_unlock(&oled_fb.lock);
 }
 
 void oled_msg(struct i2c_client *client, u8 Ypos, u8 Xpos, u8 *str)
 {
     if (Ypos >= OLED_PAGES || Xpos >= OLED_WIDTH)
         return;
-    oled_write_cmd(client, 0x00 + (0x0F & Xpos));
-    oled_write_cmd(client, 0x10 + (0x0F & (Xpos >> 4)));
-    oled_write_cmd(client, 0xB0 + Ypos);
-    oled_print(client, str);
+    mutex_lock(&oled_fb.lock);
+    oled_fb.cur_page = Ypos;
+    oled_fb.cur_col = Xpos;
+    oled_fb_text(str);
+    oled_fb_flush(client);
+    mutex_unlock(&oled_fb.lock);
 }
 
 int DS1307_tx(struct i2c_client *client, u8 reg, u8 *data, int data_len)
@@ -279,15 +588,243 @@ int time2sec(int h, int m, int s){
 }
 
 
+/* Doi mot trang SSD1306 (8 hang x 128 cot, bit 0 o tren) tu vmem 1bpp */
+static void oled_fb_from_mono(const u8 *vmem, u8 page)
+{
+    int col, k;
+    u8 val;
+
+    for (col = 0; col < OLED_WIDTH; col++) {
+        val = 0;
+        for (k = 0; k < 8; k++) {
+            const u8 *line = vmem + (page * 8 + k) * OLED_FB_LINE;
+
+            if (line[col / 8] & (1 << (col % 8)))
+                val |= 1 << k;
+        }
+        oled_fb_put(page, col, val);
+    }
+}
+
+/*
+ * Goi tu workqueue cua fb_deferred_io toi da fb_fps lan/giay, du ung dung ghi
+ * bao nhieu lan. Khi thread dong ho dang chay, trang OLED_CLOCK_PAGE thuoc ve
+ * dong ho va khong bi vmem ghi de.
+ */
+static void oled_fb_deferred_io(struct fb_info *info, struct list_head *pagelist)
+{
+    struct i2c_client *client = info->par;
+    int page;
+
+    mutex_lock(&oled_fb.lock);
+    for (page = 0; page < OLED_PAGES; page++) {
+        if (page == OLED_CLOCK_PAGE && oled_fb.clock_running)
+            continue;
+        oled_fb_from_mono((const u8 *)info->screen_buffer, page);
+    }
+    oled_fb_flush(client);
+    mutex_unlock(&oled_fb.lock);
+}
+
+static struct fb_deferred_io oled_fb_defio = {
+    .deferred_io = oled_fb_deferred_io,
+};
+
+/* write()/ve bang fb_sys_* khong qua page fault: tu len lich flush */
+static void oled_fb_schedule(struct fb_info *info)
+{
+    schedule_delayed_work(&info->deferred_work, oled_fb_defio.delay);
+}
+
+static ssize_t oled_fb_write(struct fb_info *info, const char __user *buf,
+                             size_t count, loff_t *ppos)
+{
+    ssize_t ret = fb_sys_write(info, buf, count, ppos);
+
+    if (ret > 0)
+        oled_fb_schedule(info);
+    return ret;
+}
+
+static void oled_fb_fillrect(struct fb_info *info, const struct fb_fillrect *rect)
+{
+    sys_fillrect(info, rect);
+    oled_fb_schedule(info);
+}
+
+static void oled_fb_copyarea(struct fb_info *info, const struct fb_copyarea *area)
+{
+    sys_copyarea(info, area);
+    oled_fb_schedule(info);
+}
+
+static void oled_fb_imageblit(struct fb_info *info, const struct fb_image *image)
+{
+    sys_imageblit(info, image);
+    oled_fb_schedule(info);
+}
+
+/* Khong const: tren 5.4 fb_deferred_io_init()/cleanup() ghi fbops->fb_mmap */
+static struct fb_ops oled_fb_ops = {
+    .owner = THIS_MODULE,
+    .fb_read = fb_sys_read,
+    .fb_write = oled_fb_write,
+    .fb_fillrect = oled_fb_fillrect,
+    .fb_copyarea = oled_fb_copyarea,
+    .fb_imageblit = oled_fb_imageblit,
+};
+
+// echo 0..255 > /sys/kernel/debug/ssd1306/contrast
+static int oled_contrast_get(void *data, u64 *val)
+{
+    *val = oled_contrast;
+    return 0;
+}
+
+static int oled_contrast_set(void *data, u64 val)
+{
+    int ret;
+
+    if (val > 0xFF)
+        return -EINVAL;
+    // Khong chen giua batch cua so va du lieu cua oled_fb_flush()
+    mutex_lock(&oled_fb.lock);
+    ret = oled_set_contrast(data, val);
+    if (ret == 0)
+        oled_contrast = val;
+    mutex_unlock(&oled_fb.lock);
+    return ret;
+}
+DEFINE_DEBUGFS_ATTRIBUTE(oled_contrast_fops, oled_contrast_get, oled_contrast_set, "%llu\n");
+
+static int oled_fbdev_register(struct i2c_client *client)
+{
+    struct fb_info *info;
+    u8 *vmem;
+    int ret;
+
+    info = framebuffer_alloc(0, &client->dev);
+    if (!info)
+        return -ENOMEM;
+
+    // deferred io map vmem theo trang nen phai la trang that, khong dung kmalloc
+    vmem = (u8 *)__get_free_pages(GFP_KERNEL | __GFP_ZERO, get_order(OLED_FB_SIZE));
+    if (!vmem) {
+        ret = -ENOMEM;
+        goto err_release;
+    }
+
+    info->par = client;
+    info->fbops = &oled_fb_ops;
+    info->flags = FBINFO_FLAG_DEFAULT | FBINFO_VIRTFB;
+
+    strscpy(info->fix.id, "ssd1306", sizeof(info->fix.id));
+    info->fix.type = FB_TYPE_PACKED_PIXELS;
+    info->fix.visual = FB_VISUAL_MONO10;
+    info->fix.line_length = OLED_FB_LINE;
+    info->fix.smem_start = __pa(vmem);
+    info->fix.smem_len = OLED_FB_SIZE;
+
+    info->var.xres = OLED_WIDTH;
+    info->var.xres_virtual = OLED_WIDTH;
+    info->var.yres = OLED_HEIGHT;
+    info->var.yres_virtual = OLED_HEIGHT;
+    info->var.bits_per_pixel = 1;
+    info->var.red.length = 1;
+    info->var.green.length = 1;
+    info->var.blue.length = 1;
+
+    info->screen_buffer = (char *)vmem;
+    info->screen_size = OLED_FB_SIZE;
+
+    oled_fb_defio.delay = HZ / clamp_t(unsigned int, fb_fps, 1, HZ);
+    info->fbdefio = &oled_fb_defio;
+    fb_deferred_io_init(info);
+
+    ret = register_framebuffer(info);
+    if (ret) {
+        dev_err(&client->dev, "OLED: Failed to register framebuffer: %d\n", ret);
+        goto err_defio;
+    }
+    oled_fb_info = info;
+    dev_info(&client->dev, "OLED: /dev/fb%d registered, max %u fps\n",
+             info->node, HZ / (unsigned int)oled_fb_defio.delay);
+    return 0;
+
+err_defio:
+    fb_deferred_io_cleanup(info);
+    free_pages((unsigned long)vmem, get_order(OLED_FB_SIZE));
+err_release:
+    framebuffer_release(info);
+    return ret;
+}
+
+static void oled_fbdev_unregister(void)
+{
+    struct fb_info *info = oled_fb_info;
+
+    if (!info)
+        return;
+    oled_fb_info = NULL;
+    unregister_framebuffer(info);
+    fb_deferred_io_cleanup(info); // cho flush cuoi cung xong
+    free_pages((unsigned long)info->screen_buffer, get_order(OLED_FB_SIZE));
+    framebuffer_release(info);
+}
+
+// Canh xuong SQW: giay cua DS1307 vua nhay
+static irqreturn_t ds1307_sqw_irq(int irq, void *data)
+{
+    atomic_inc(&rtc_tick);
+    wake_up(&rtc_tick_wq);
+    return IRQ_HANDLED;
+}
+
+// Bat SQW 1 Hz va dang ky ngat; loi thi background_task tu doc thu
+static void ds1307_sqw_setup(struct i2c_client *client)
+{
+    u8 ctrl = DS1307_SQW_1HZ;
+    int ret;
+
+    if (client->irq <= 0)
+        return;
+    ret = DS1307_tx(client, DS1307_REG_CONTROL, &ctrl, 1);
+    if (!ret)
+        ret = devm_request_irq(&client->dev, client->irq, ds1307_sqw_irq,
+                               IRQF_TRIGGER_FALLING, "ds1307-sqw", NULL);
+    if (ret) {
+        dev_warn(&client->dev, "DS1307: SQW IRQ unavailable (%d), polling seconds register\n", ret);
+        return;
+    }
+    rtc_sqw_irq = true;
+    dev_info(&client->dev, "DS1307: Display driven by SQW IRQ %d\n", client->irq);
+}
+
+static void ds1307_sqw_stop(struct i2c_client *client)
+{
+    u8 ctrl = 0;
+
+    if (!rtc_sqw_irq)
+        return;
+    rtc_sqw_irq = false;
+    DS1307_tx(client, DS1307_REG_CONTROL, &ctrl, 1);
+}
+
 // Kthread function để display time trên OLED
 static int background_task(void *data)
 {
-    dev_info(&oled_client_global->dev, "%s: Kthread started successfully.\n", DRIVER_NAME);
     u8 raw_time[7];
     char sec_str[3], min_str[3], hrs_str[3];
     char time_buf[9]; // "HH:MM:SS\0"
     int ret;
     int sec, min, hrs;
+    int last_sec = -1;
+    int seen = atomic_read(&rtc_tick);
+    unsigned int reads = 0;
+    ktime_t edge;
+    s64 spent;
+
+    dev_info(&oled_client_global->dev, "%s: Kthread started successfully.\n", DRIVER_NAME);
 
     while (!kthread_should_stop()) {
         if (!rtc_client_global || !oled_client_global) {
@@ -296,15 +833,41 @@ static int background_task(void *data)
             continue;
         }
 
+        if (rtc_sqw_irq) {
+            // Cho canh giay; het 2 s ma khong co ngat thi van doc de dong ho khong dung
+            wait_event_interruptible_timeout(rtc_tick_wq,
+                    atomic_read(&rtc_tick) != seen || kthread_should_stop(), 2 * HZ);
+            if (kthread_should_stop())
+                break;
+            seen = atomic_read(&rtc_tick);
+        }
+
         ret = DS1307_get_time(rtc_client_global, raw_time);
         if (ret < 0) {
             dev_err(&rtc_client_global->dev, "%s: Error getting time: %d, retrying...\n", DRIVER_NAME, ret);
+            last_sec = -1;
             msleep(1000);
             continue;
         }
 
         // Revert BCD to decimal
         sec = DS1307_reverter(raw_time[0] & 0x7F); // Mask CH bit
+
+        // Che do doc thu: giay chua doi nghia la chua toi canh
+        if (!rtc_sqw_irq && sec == last_sec) {
+            if (++reads >= OLED_CLOCK_MAX_READS) {
+                // Qua so lan doc cho phep ma giay khong doi (dao dong dung?)
+                reads = 0;
+                msleep(1000);
+            } else {
+                usleep_range(OLED_CLOCK_POLL_US, OLED_CLOCK_POLL_US + 1000);
+            }
+            continue;
+        }
+        edge = ktime_get();
+        last_sec = sec;
+        reads = 0;
+
         min = DS1307_reverter(raw_time[1]);
         hrs = DS1307_reverter(raw_time[2]);
         
@@ -316,11 +879,23 @@ static int background_task(void *data)
         int2str(sec, sec_str);
         snprintf(time_buf, sizeof(time_buf), "%s:%s:%s", hrs_str, min_str, sec_str);
 
-        // Clear page and display
-        oled_clear_page(oled_client_global, 4);
-        oled_msg(oled_client_global, 4, 0, (u8 *)time_buf);
+        // Chi ve lai cac ky tu doi (thuong chi chu so giay cuoi = 6 cot)
+        mutex_lock(&oled_fb.lock);
+        oled_fb_text_diff(OLED_CLOCK_PAGE, 0, time_buf,
+                          oled_clock_last, sizeof(oled_clock_last));
+        oled_fb_flush(oled_client_global);
+        mutex_unlock(&oled_fb.lock);
 
-        msleep(10);
+        if (rtc_sqw_irq)
+            continue;
+        /*
+         * Ngu toi ngay truoc canh giay tiep theo. Guard lon hon do tre cua
+         * msleep(), nen neu lan nay bat canh muon thi lan sau se thuc day som
+         * hon va pha tu keo ve.
+         */
+        spent = ktime_ms_delta(ktime_get(), edge);
+        if (spent < 1000 - OLED_CLOCK_GUARD_MS)
+            msleep(1000 - OLED_CLOCK_GUARD_MS - spent);
     }
     dev_info(&oled_client_global->dev, "%s: Kthread terminated.\n", DRIVER_NAME);
     return 0;
@@ -388,9 +963,20 @@ static int combined_i2c_probe(struct i2c_client *client, const struct i2c_device
         ret = oled_hw_init(client);
         if (ret) return ret; 
         
+        oled_fb_reset();
         oled_blank(client);
         oled_msg(client, 2, 3, (u8 *)str);
         oled_client_global = client; // Lưu client toàn cục
+
+        oled_debugfs = debugfs_create_dir("ssd1306", NULL);
+        debugfs_create_u64("xfers", 0444, oled_debugfs, &oled_stats.xfers);
+        debugfs_create_u64("bytes", 0444, oled_debugfs, &oled_stats.bytes);
+        debugfs_create_file_unsafe("contrast", 0644, oled_debugfs, client, &oled_contrast_fops);
+
+        // /dev/fbN la tuy chon: loi o day khong lam hong dong ho
+        ret = oled_fbdev_register(client);
+        if (ret)
+            dev_warn(&client->dev, "OLED: Continuing without framebuffer device (%d)\n", ret);
         
         dev_info(&client->dev, "SSD1306: Probe successful. Display initialized.\n");
     }
@@ -406,11 +992,13 @@ static int combined_i2c_probe(struct i2c_client *client, const struct i2c_device
             return ret;
         }
         rtc_client_global = client; // Lưu client toàn cục
+        ds1307_sqw_setup(client);
         
         // 1. ĐĂNG KÝ MISC DEVICE (Chỉ khi RTC probe thành công)
         ret = misc_register(&combined_misc_device);
         if (ret) {
             dev_err(&client->dev, "%s: Failed to register misc device: %d\n", DRIVER_NAME, ret);
+            ds1307_sqw_stop(client);
             rtc_client_global = NULL; // Cleanup global
             return ret;
         }
@@ -423,14 +1011,19 @@ static int combined_i2c_probe(struct i2c_client *client, const struct i2c_device
         display_kthread = kthread_run(background_task, NULL, DRIVER_NAME "_display");
         if (IS_ERR(display_kthread)) {
             ret = PTR_ERR(display_kthread);
+            display_kthread = NULL;
             dev_err(&client->dev, "%s: Failed to create kernel thread: %d\n", DRIVER_NAME, ret);
             // Cleanup: Đăng ký Misc thất bại, cần hủy đăng ký (Chỉ xảy ra nếu RTC probe sau OLED)
             if (of_device_is_compatible(client->dev.of_node, DS1307_COMPATIBLE)) {
                 misc_deregister(&combined_misc_device);
+                ds1307_sqw_stop(client);
                 rtc_client_global = NULL; 
             }
             return ret;
         }
+        mutex_lock(&oled_fb.lock);
+        oled_fb.clock_running = true;
+        mutex_unlock(&oled_fb.lock);
         dev_info(&client->dev, "%s: Display thread started successfully.\n", DRIVER_NAME);
     } else if (of_device_is_compatible(client->dev.of_node, DS1307_COMPATIBLE)) {
         // Chỉ hiện cảnh báo nếu là DS1307 (vì DS1307 chịu trách nhiệm khởi động thread)
@@ -451,9 +1044,14 @@ static int combined_i2c_remove(struct i2c_client *client)
         if (display_kthread) {
             kthread_stop(display_kthread);
             display_kthread = NULL;
+            mutex_lock(&oled_fb.lock);
+            oled_fb.clock_running = false; // /dev/fbN lay lai trang dong ho
+            mutex_unlock(&oled_fb.lock);
             dev_info(&client->dev, "%s: Kthread stopped.\n", DRIVER_NAME);
         }
         
+        ds1307_sqw_stop(client);
+
         // 2. Dọn dẹp Misc Device
         misc_deregister(&combined_misc_device);
         dev_info(&client->dev, "%s: Misc device deregistered.\n", DRIVER_NAME);
@@ -464,8 +1062,11 @@ static int combined_i2c_remove(struct i2c_client *client)
 
     // Dọn dẹp OLED (Khi client OLED bị remove)
     if (of_device_is_compatible(client->dev.of_node, OLED_COMPATIBLE)) {
+        oled_fbdev_unregister();
         oled_blank(client);
         oled_client_global = NULL;
+        debugfs_remove_recursive(oled_debugfs);
+        oled_debugfs = NULL;
         dev_info(&client->dev, "OLED: Display blanked and global client cleared.\n");
     }
 
@@ -498,7 +1099,20 @@ static struct i2c_driver combined_driver = {
     .id_table = combined_id,
 };
 
-module_i2c_driver(combined_driver);
+static int __init combined_init(void)
+{
+    mutex_init(&oled_fb.lock);
+    oled_fb_reset();
+    return i2c_add_driver(&combined_driver);
+}
+
+static void __exit combined_exit(void)
+{
+    i2c_del_driver(&combined_driver);
+}
+
+module_init(combined_init);
+module_exit(combined_exit);
 MODULE_LICENSE("GPL");
 MODULE_AUTHOR("Dang Van Phuc");
 MODULE_DESCRIPTION("Driver for SSD1306 OLED and DS1307 RTC using I2C.");
\ No newline at end of file
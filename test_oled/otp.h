@@ -7,11 +7,86 @@
 
 #define step 30 // time-step default value is 30 seconds
 
+#define OTP_MAX_DIGITS 10 // codes are 1..10 digits; RFC 4226/6238 use 6-8
+
+// HMAC hash for a key; RFC 6238 allows SHA-1 (default), SHA-256 and SHA-512
+typedef enum {
+    OTP_SHA1,
+    OTP_SHA256,
+    OTP_SHA512,
+} otp_alg;
+
+struct otp_hmac_ops;
+
+// HMAC key schedule: hash midstates after absorbing k_ipad / k_opad.
+// Built once per key, each HOTP from it costs two compressions instead of four.
+// ops is picked once at init, so generating codes never branches on the algorithm.
+typedef struct {
+    const struct otp_hmac_ops* ops;
+    union {
+        struct { uint32_t istate[5], ostate[5]; } sha1;
+        struct { uint32_t istate[8], ostate[8]; } sha256;
+        struct { uint64_t istate[8], ostate[8]; } sha512;
+    } h;
+} otp_key_ctx;
+
+void otp_key_init_alg(otp_key_ctx* kctx, otp_alg alg, const uint8_t* key, size_t klen);
+
+// Same as otp_key_init_alg(kctx, OTP_SHA1, key, klen)
+void otp_key_init(otp_key_ctx* kctx, const uint8_t* key, size_t klen);
+
+void otp_key_wipe(otp_key_ctx* kctx);
+
+uint32_t hotp_ctx(const otp_key_ctx* kctx, uint64_t interval, int digits);
+
+// One counter for a fleet of n keys, hashed in SIMD lanes (SHA1Transform_xN).
+// Keys that are not SHA-1 are computed one at a time with hotp_ctx().
+size_t hotp_multi(const otp_key_ctx* kctxs, size_t n, uint64_t interval, int digits, uint32_t* out);
+
+// HMAC-SHA1 of the (big-endian) interval. hmacsha() returns a static buffer and is
+// not thread-safe; hmacsha_r() writes into the caller's digest and returns it.
+unsigned char* hmacsha(const unsigned char* key, int klen, uint64_t interval);
+
+unsigned char* hmacsha_r(const unsigned char* key, int klen, uint64_t interval, unsigned char digest[20]);
+
 uint32_t totp(uint8_t* key, size_t klen, uint64_t time, int digits);
 
 uint32_t hotp(uint8_t* key, size_t klen, uint64_t interval, int digits);
 
-double my_floor(double x);
+// Codes for counters [first, first + count) into out[]; the key is set up once.
+size_t hotp_batch(uint8_t* key, size_t klen, uint64_t first, size_t count, int digits, uint32_t* out);
+
+// Codes for steps [time - window, time + window] (clamped at 0); returns how many were written.
+size_t totp_window(uint8_t* key, size_t klen, uint64_t time, unsigned int window, int digits, uint32_t* out);
+
+// Per-key TOTP verifier state: remembers the last accepted step and the clock drift
+// it was found at, so the next check tries that offset first (one HMAC instead of 2N+1).
+typedef struct {
+    otp_key_ctx key;
+    int digits;
+    unsigned int window; // accept steps within +-window of the caller's step
+    int predict;         // 1: try time + drift first (default), 0: always scan from time
+    int64_t t0;          // RFC 6238 T0 for totp_verify_time(), default 0
+    uint32_t period;     // RFC 6238 time step in seconds, default step (30)
+    int64_t drift;       // offset of the last accepted step from the caller's step
+    uint64_t last_step;  // last accepted step; it and older ones are rejected as replays
+    int has_last;
+} totp_verifier;
+
+void totp_verifier_init(totp_verifier* v, const uint8_t* key, size_t klen, int digits, unsigned int window);
+
+// 1 if code matches a step in [time - window, time + window], 0 otherwise. Codes are
+// compared in constant time; drift and last_step are updated on success.
+int totp_verify(totp_verifier* v, uint64_t time, uint32_t code);
+
+// Same, from a Unix time using the verifier's own t0 and period
+int totp_verify_time(totp_verifier* v, int64_t unix_time, uint32_t code);
+
+// RFC 6238 counter floor((unix_time - t0) / period) in integer arithmetic, 64-bit safe.
+// Times before t0 map to step 0.
+uint64_t totp_step(int64_t unix_time, int64_t t0, uint32_t period);
+
+double my_floor(double x); // kept for old callers; getTime() no longer uses it
 
 time_t getTime(time_t T0);
 
@@ -8,6 +8,7 @@
  */
 
 #include "stdint.h"
+#include <stddef.h>
 
 #if defined(__cplusplus)
 extern "C" {
@@ -25,6 +26,36 @@ void SHA1Transform(
     const unsigned char buffer[64]
     );
 
+/* Hash nblocks consecutive 64-byte blocks in place (no copy into a context) */
+void SHA1TransformBlocks(
+    uint32_t state[5],
+    const unsigned char *data,
+    size_t nblocks
+    );
+
+/* Name of the SHA1Transform backend in use: "shani", "armce", "scalar"
+ * (zero-copy) or "handsoff" (original copy-then-swap, kept for comparison) */
+const char *SHA1Backend(
+    void
+    );
+
+/* Force a backend by name; returns -1 if unknown or unsupported on this CPU */
+int SHA1SetBackend(
+    const char *name
+    );
+
+/* Hash one block for each of n independent messages (multi-buffer SIMD) */
+void SHA1Transform_xN(
+    uint32_t state[][5],
+    const unsigned char *const buffer[],
+    size_t n
+    );
+
+/* Number of lanes the widest available SHA1Transform_xN kernel uses */
+unsigned SHA1Lanes(
+    void
+    );
+
 void SHA1Init(
     SHA1_CTX * context
     );
@@ -45,6 +76,11 @@ void SHA1(
     const char *str,
     uint32_t len);
 
+/* Hash a file (mmap for regular files); returns 0, or -1 with errno set */
+int SHA1File(
+    unsigned char digest[20],
+    const char *path);
+
 #if defined(__cplusplus)
 }
 #endif
@@ -0,0 +1,291 @@
+/*
+SHA-256 / SHA-512 in C (FIPS 180-4), same structure as sha1.c.
+
+Test Vectors
+"abc"
+  SHA-256: BA7816BF 8F01CFEA 414140DE 5DAE2223 B00361A3 96177A9C B410FF61 F20015AD
+  SHA-512: DDAF35A193617ABA CC417349AE204131 12E6FA4E89A97EA2 0A9EEEE64B55D39A
+           2192992A274FC1A8 36BA3C23A3FEEBBD 454D4423643CE80E 2A9AC94FA54CA49F
+*/
+
+#include <string.h>
+#include <stdint.h>
+
+#include "sha2.h"
+
+
+#define ror32(value, bits) (((value) >> (bits)) | ((value) << (32 - (bits))))
+#define ror64(value, bits) (((value) >> (bits)) | ((value) << (64 - (bits))))
+
+#define load_be32(p) (((uint32_t) (p)[0] << 24) | ((uint32_t) (p)[1] << 16) | \
+    ((uint32_t) (p)[2] << 8) | (uint32_t) (p)[3])
+#define load_be64(p) (((uint64_t) load_be32(p) << 32) | load_be32((p) + 4))
+
+#define Ch(x,y,z) (((x) & ((y) ^ (z))) ^ (z))
+#define Maj(x,y,z) (((x) & (y)) | ((z) & ((x) | (y))))
+
+static const uint32_t K256[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+static const uint64_t K512[80] = {
+    0x428a2f98d728ae22ULL, 0x7137449123ef65cdULL, 0xb5c0fbcfec4d3b2fULL, 0xe9b5dba58189dbbcULL,
+    0x3956c25bf348b538ULL, 0x59f111f1b605d019ULL, 0x923f82a4af194f9bULL, 0xab1c5ed5da6d8118ULL,
+    0xd807aa98a3030242ULL, 0x12835b0145706fbeULL, 0x243185be4ee4b28cULL, 0x550c7dc3d5ffb4e2ULL,
+    0x72be5d74f27b896fULL, 0x80deb1fe3b1696b1ULL, 0x9bdc06a725c71235ULL, 0xc19bf174cf692694ULL,
+    0xe49b69c19ef14ad2ULL, 0xefbe4786384f25e3ULL, 0x0fc19dc68b8cd5b5ULL, 0x240ca1cc77ac9c65ULL,
+    0x2de92c6f592b0275ULL, 0x4a7484aa6ea6e483ULL, 0x5cb0a9dcbd41fbd4ULL, 0x76f988da831153b5ULL,
+    0x983e5152ee66dfabULL, 0xa831c66d2db43210ULL, 0xb00327c898fb213fULL, 0xbf597fc7beef0ee4ULL,
+    0xc6e00bf33da88fc2ULL, 0xd5a79147930aa725ULL, 0x06ca6351e003826fULL, 0x142929670a0e6e70ULL,
+    0x27b70a8546d22ffcULL, 0x2e1b21385c26c926ULL, 0x4d2c6dfc5ac42aedULL, 0x53380d139d95b3dfULL,
+    0x650a73548baf63deULL, 0x766a0abb3c77b2a8ULL, 0x81c2c92e47edaee6ULL, 0x92722c851482353bULL,
+    0xa2bfe8a14cf10364ULL, 0xa81a664bbc423001ULL, 0xc24b8b70d0f89791ULL, 0xc76c51a30654be30ULL,
+    0xd192e819d6ef5218ULL, 0xd69906245565a910ULL, 0xf40e35855771202aULL, 0x106aa07032bbd1b8ULL,
+    0x19a4c116b8d2d0c8ULL, 0x1e376c085141ab53ULL, 0x2748774cdf8eeb99ULL, 0x34b0bcb5e19b48a8ULL,
+    0x391c0cb3c5c95a63ULL, 0x4ed8aa4ae3418acbULL, 0x5b9cca4f7763e373ULL, 0x682e6ff3d6b2b8a3ULL,
+    0x748f82ee5defb2fcULL, 0x78a5636f43172f60ULL, 0x84c87814a1f0ab72ULL, 0x8cc702081a6439ecULL,
+    0x90befffa23631e28ULL, 0xa4506cebde82bde9ULL, 0xbef9a3f7b2c67915ULL, 0xc67178f2e372532bULL,
+    0xca273eceea26619cULL, 0xd186b8c721c0c207ULL, 0xeada7dd6cde0eb1eULL, 0xf57d4f7fee6ed178ULL,
+    0x06f067aa72176fbaULL, 0x0a637dc5a2c898a6ULL, 0x113f9804bef90daeULL, 0x1b710b35131c471bULL,
+    0x28db77f523047d84ULL, 0x32caab7b40c72493ULL, 0x3c9ebe0a15c9bebcULL, 0x431d67c49c100d4cULL,
+    0x4cc5d4becb3e42b6ULL, 0x597f299cfc657e2aULL, 0x5fcb6fab3ad6faecULL, 0x6c44198c4a475817ULL
+};
+
+
+/* Hash a single 512-bit block; the schedule is a rolling 16-word window */
+
+void SHA256Transform(
+    uint32_t state[8],
+    const unsigned char buffer[64]
+)
+{
+    uint32_t a, b, c, d, e, f, g, h, t1, t2;
+    uint32_t W[16];
+    int i;
+
+    a = state[0];
+    b = state[1];
+    c = state[2];
+    d = state[3];
+    e = state[4];
+    f = state[5];
+    g = state[6];
+    h = state[7];
+    for (i = 0; i < 64; i++)
+    {
+        if (i < 16)
+            W[i] = load_be32(buffer + 4 * i);
+        else
+        {
+            uint32_t w15 = W[(i + 1) & 15], w2 = W[(i + 14) & 15];
+
+            W[i & 15] += (ror32(w15, 7) ^ ror32(w15, 18) ^ (w15 >> 3)) + W[(i + 9) & 15] +
+                (ror32(w2, 17) ^ ror32(w2, 19) ^ (w2 >> 10));
+        }
+        t1 = h + (ror32(e, 6) ^ ror32(e, 11) ^ ror32(e, 25)) + Ch(e, f, g) + K256[i] + W[i & 15];
+        t2 = (ror32(a, 2) ^ ror32(a, 13) ^ ror32(a, 22)) + Maj(a, b, c);
+        h = g;
+        g = f;
+        f = e;
+        e = d + t1;
+        d = c;
+        c = b;
+        b = a;
+        a = t1 + t2;
+    }
+    state[0] += a;
+    state[1] += b;
+    state[2] += c;
+    state[3] += d;
+    state[4] += e;
+    state[5] += f;
+    state[6] += g;
+    state[7] += h;
+    /* Wipe variables */
+    memset(W, '\0', sizeof(W));
+}
+
+void SHA256Init(
+    SHA256_CTX * context
+)
+{
+    context->state[0] = 0x6a09e667;
+    context->state[1] = 0xbb67ae85;
+    context->state[2] = 0x3c6ef372;
+    context->state[3] = 0xa54ff53a;
+    context->state[4] = 0x510e527f;
+    context->state[5] = 0x9b05688c;
+    context->state[6] = 0x1f83d9ab;
+    context->state[7] = 0x5be0cd19;
+    context->count = 0;
+}
+
+void SHA256Update(
+    SHA256_CTX * context,
+    const unsigned char *data,
+    size_t len
+)
+{
+    size_t j = context->count & 63;
+
+    context->count += len;
+    if (j)
+    {
+        size_t n = 64 - j < len ? 64 - j : len;
+
+        memcpy(&context->buffer[j], data, n);
+        data += n;
+        len -= n;
+        if (j + n < 64)
+            return;
+        SHA256Transform(context->state, context->buffer);
+    }
+    for (; len >= 64; len -= 64, data += 64)
+        SHA256Transform(context->state, data);
+    memcpy(context->buffer, data, len);
+}
+
+void SHA256Final(
+    unsigned char digest[32],
+    SHA256_CTX * context
+)
+{
+    static const unsigned char padding[64] = { 0200 };
+    unsigned char finalcount[8];
+    uint64_t bits = context->count << 3;
+    size_t r = context->count & 63;
+    int i;
+
+    for (i = 0; i < 8; i++)
+        finalcount[i] = (unsigned char) (bits >> ((7 - i) * 8));
+    SHA256Update(context, padding, r < 56 ? 56 - r : 120 - r);
+    SHA256Update(context, finalcount, 8);
+    for (i = 0; i < 32; i++)
+        digest[i] = (unsigned char) (context->state[i >> 2] >> ((3 - (i & 3)) * 8));
+    /* Wipe variables */
+    memset(context, '\0', sizeof(*context));
+}
+
+
+/* Hash a single 1024-bit block */
+
+void SHA512Transform(
+    uint64_t state[8],
+    const unsigned char buffer[128]
+)
+{
+    uint64_t a, b, c, d, e, f, g, h, t1, t2;
+    uint64_t W[16];
+    int i;
+
+    a = state[0];
+    b = state[1];
+    c = state[2];
+    d = state[3];
+    e = state[4];
+    f = state[5];
+    g = state[6];
+    h = state[7];
+    for (i = 0; i < 80; i++)
+    {
+        if (i < 16)
+            W[i] = load_be64(buffer + 8 * i);
+        else
+        {
+            uint64_t w15 = W[(i + 1) & 15], w2 = W[(i + 14) & 15];
+
+            W[i & 15] += (ror64(w15, 1) ^ ror64(w15, 8) ^ (w15 >> 7)) + W[(i + 9) & 15] +
+                (ror64(w2, 19) ^ ror64(w2, 61) ^ (w2 >> 6));
+        }
+        t1 = h + (ror64(e, 14) ^ ror64(e, 18) ^ ror64(e, 41)) + Ch(e, f, g) + K512[i] + W[i & 15];
+        t2 = (ror64(a, 28) ^ ror64(a, 34) ^ ror64(a, 39)) + Maj(a, b, c);
+        h = g;
+        g = f;
+        f = e;
+        e = d + t1;
+        d = c;
+        c = b;
+        b = a;
+        a = t1 + t2;
+    }
+    state[0] += a;
+    state[1] += b;
+    state[2] += c;
+    state[3] += d;
+    state[4] += e;
+    state[5] += f;
+    state[6] += g;
+    state[7] += h;
+    /* Wipe variables */
+    memset(W, '\0', sizeof(W));
+}
+
+void SHA512Init(
+    SHA512_CTX * context
+)
+{
+    context->state[0] = 0x6a09e667f3bcc908ULL;
+    context->state[1] = 0xbb67ae8584caa73bULL;
+    context->state[2] = 0x3c6ef372fe94f82bULL;
+    context->state[3] = 0xa54ff53a5f1d36f1ULL;
+    context->state[4] = 0x510e527fade682d1ULL;
+    context->state[5] = 0x9b05688c2b3e6c1fULL;
+    context->state[6] = 0x1f83d9abfb41bd6bULL;
+    context->state[7] = 0x5be0cd19137e2179ULL;
+    context->count = 0;
+}
+
+void SHA512Update(
+    SHA512_CTX * context,
+    const unsigned char *data,
+    size_t len
+)
+{
+    size_t j = context->count & 127;
+
+    context->count += len;
+    if (j)
+    {
+        size_t n = 128 - j < len ? 128 - j : len;
+
+        memcpy(&context->buffer[j], data, n);
+        data += n;
+        len -= n;
+        if (j + n < 128)
+            return;
+        SHA512Transform(context->state, context->buffer);
+    }
+    for (; len >= 128; len -= 128, data += 128)
+        SHA512Transform(context->state, data);
+    memcpy(context->buffer, data, len);
+}
+
+void SHA512Final(
+    unsigned char digest[64],
+    SHA512_CTX * context
+)
+{
+    static const unsigned char padding[128] = { 0200 };
+    unsigned char finalcount[16] = { 0 };
+    uint64_t bits = context->count << 3;
+    size_t r = context->count & 127;
+    int i;
+
+    /* 128-bit length; the high 64 bits only matter past 2^61 bytes */
+    finalcount[7] = (unsigned char) (context->count >> 61);
+    for (i = 0; i < 8; i++)
+        finalcount[8 + i] = (unsigned char) (bits >> ((7 - i) * 8));
+    SHA512Update(context, padding, r < 112 ? 112 - r : 240 - r);
+    SHA512Update(context, finalcount, 16);
+    for (i = 0; i < 64; i++)
+        digest[i] = (unsigned char) (context->state[i >> 3] >> ((7 - (i & 7)) * 8));
+    /* Wipe variables */
+    memset(context, '\0', sizeof(*context));
+}
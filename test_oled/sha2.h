@@ -0,0 +1,74 @@
+#ifndef SHA2_H
+#define SHA2_H
+
+/*
+   SHA-256 and SHA-512 (FIPS 180-4) in C, same API shape as sha1.h.
+   Used by otp.c for the RFC 6238 HMAC-SHA256/512 variants.
+ */
+
+#include "stdint.h"
+#include <stddef.h>
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+typedef struct
+{
+    uint32_t state[8];
+    uint64_t count;             /* bytes hashed so far */
+    unsigned char buffer[64];
+} SHA256_CTX;
+
+typedef struct
+{
+    uint64_t state[8];
+    uint64_t count;             /* bytes hashed so far (inputs < 2^64 bytes) */
+    unsigned char buffer[128];
+} SHA512_CTX;
+
+void SHA256Transform(
+    uint32_t state[8],
+    const unsigned char buffer[64]
+    );
+
+void SHA256Init(
+    SHA256_CTX * context
+    );
+
+void SHA256Update(
+    SHA256_CTX * context,
+    const unsigned char *data,
+    size_t len
+    );
+
+void SHA256Final(
+    unsigned char digest[32],
+    SHA256_CTX * context
+    );
+
+void SHA512Transform(
+    uint64_t state[8],
+    const unsigned char buffer[128]
+    );
+
+void SHA512Init(
+    SHA512_CTX * context
+    );
+
+void SHA512Update(
+    SHA512_CTX * context,
+    const unsigned char *data,
+    size_t len
+    );
+
+void SHA512Final(
+    unsigned char digest[64],
+    SHA512_CTX * context
+    );
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* SHA2_H */